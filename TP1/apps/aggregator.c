@@ -0,0 +1,370 @@
+// Agregador da frota: recebe as métricas dos monitores (hello --push) por UDP
+// e serve um painel único com todos os nós e a API em JSON
+// Guilherme Specht
+//
+// Processo de uma thread: poll() sobre o socket UDP e o socket HTTP. Cada nó
+// ocupa uma entrada de uma tabela hash de endereçamento aberto, com o último
+// keyframe (base dos deltas) e os valores mais recentes.
+//
+// Uso: aggregator [-u porta_udp] [-p porta_http]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "fleet.h"
+
+#define HTTP_PORT     8081     // Porta padrão do painel
+#define MAX_NODES     4096     // Capacidade da tabela (potência de 2)
+#define STALE_SECONDS 10       // Nó sem pacotes há mais tempo aparece como inativo
+#define UDP_BATCH     64       // Datagramas drenados por volta do laço
+#define PAGE_SIZE_MAX (1024 * 1024)
+
+static const char *metric_names[FLEET_METRICS] = {
+    "uptime_s", "idle_s", "load1", "load5", "load15", "cpu_usage",
+    "mem_total_kb", "mem_used_kb", "io_reads", "io_writes",
+    "net_rx_bytes", "net_tx_bytes", "psi_cpu", "psi_memory", "psi_io", "self_cpu"
+};
+
+// Estado de um nó da frota
+struct node {
+    char name[FLEET_NODE_LEN];  // Vazio: entrada livre
+    int have_base;              // Já recebeu o keyframe base_seq
+    uint32_t base_seq;          // Sequência do keyframe usado como base
+    uint32_t last_seq;          // Maior sequência recebida
+    int64_t base[FLEET_METRICS];
+    int64_t values[FLEET_METRICS];
+    unsigned long long received;  // Pacotes aceitos
+    unsigned long long lost;      // Buracos na sequência
+    unsigned long long no_base;   // Deltas descartados por falta do keyframe
+    char addr[INET6_ADDRSTRLEN];
+    time_t last_seen;
+};
+
+static struct node nodes[MAX_NODES];
+static int node_count = 0;
+static unsigned long long bad_packets = 0;
+
+void die(char *s)
+{
+    perror(s);
+    exit(1);
+}
+
+// FNV-1a do nome do nó
+static uint32_t hash_name(const char *name){
+    uint32_t h = 2166136261u;
+    while(*name){
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h;
+}
+
+// Encontra (ou cria) a entrada de um nó; NULL se a tabela estiver cheia
+static struct node *node_lookup(const char *name){
+    uint32_t i = hash_name(name) & (MAX_NODES - 1);
+    for(int probes = 0; probes < MAX_NODES; probes++, i = (i + 1) & (MAX_NODES - 1)){
+        if(nodes[i].name[0] == '\0'){
+            if(node_count >= MAX_NODES * 3 / 4){   // Mantém as sondagens curtas
+                return NULL;
+            }
+            snprintf(nodes[i].name, sizeof(nodes[i].name), "%s", name);
+            node_count++;
+            return &nodes[i];
+        }
+        if(strcmp(nodes[i].name, name) == 0){
+            return &nodes[i];
+        }
+    }
+    return NULL;
+}
+
+// O nome vem de UDP sem autenticação e vai para o JSON e o HTML: só [A-Za-z0-9._-]
+static int node_name_ok(const char *name){
+    for(; *name; name++){
+        if(!isalnum((unsigned char)*name) && *name != '.' && *name != '_' && *name != '-'){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Endereço de origem em texto; IPv4 mapeado em IPv6 (socket dual-stack) aparece como IPv4
+static void format_addr(const struct sockaddr_storage *from, char *buf, size_t size){
+    if(from->ss_family == AF_INET6){
+        const struct in6_addr *a6 = &((const struct sockaddr_in6 *)from)->sin6_addr;
+        if(IN6_IS_ADDR_V4MAPPED(a6)){
+            inet_ntop(AF_INET, &a6->s6_addr[12], buf, size);
+        }
+        else{
+            inet_ntop(AF_INET6, a6, buf, size);
+        }
+    }
+    else{
+        inet_ntop(AF_INET, &((const struct sockaddr_in *)from)->sin_addr, buf, size);
+    }
+}
+
+// Aplica um pacote ao estado do nó
+static void node_update(const struct fleet_packet *pkt, const struct sockaddr_storage *from){
+    struct node *n = node_name_ok(pkt->node) ? node_lookup(pkt->node) : NULL;
+    if(!n){
+        bad_packets++;
+        return;
+    }
+
+    if(n->received > 0){
+        if(pkt->seq > n->last_seq){
+            n->lost += pkt->seq - n->last_seq - 1;
+        }
+        else if(!(pkt->flags & FLEET_KEYFRAME)){
+            return;                     // Duplicado ou fora de ordem
+        }
+        // Keyframe com sequência menor: o hello foi reiniciado, recomeça do zero
+    }
+    n->last_seq = pkt->seq;
+    n->received++;
+    n->last_seen = time(NULL);
+    format_addr(from, n->addr, sizeof(n->addr));
+
+    if(pkt->flags & FLEET_KEYFRAME){
+        memcpy(n->base, pkt->values, sizeof(n->base));
+        memcpy(n->values, pkt->values, sizeof(n->values));
+        n->base_seq = pkt->seq;
+        n->have_base = 1;
+        return;
+    }
+    if(!n->have_base || pkt->base_seq != n->base_seq){
+        n->no_base++;                   // Keyframe perdido: espera o próximo
+        return;
+    }
+    for(int i = 0; i < FLEET_METRICS; i++){
+        n->values[i] = n->base[i] + ((pkt->mask & (1u << i)) ? pkt->values[i] : 0);
+    }
+}
+
+// Drena os datagramas pendentes sem bloquear
+static void receive_packets(int udp){
+    uint8_t buf[FLEET_MAX_PACKET];
+    struct fleet_packet pkt;
+
+    for(int i = 0; i < UDP_BATCH; i++){
+        struct sockaddr_storage from;
+        socklen_t flen = sizeof(from);
+        ssize_t len = recvfrom(udp, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &flen);
+        if(len < 0){
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+                perror("recvfrom");
+            }
+            return;
+        }
+        if(fleet_decode(buf, len, &pkt) < 0){
+            bad_packets++;
+            continue;
+        }
+        node_update(&pkt, &from);
+    }
+}
+
+// Acrescenta texto formatado à resposta
+static void page_append(char *page, size_t *len, const char *fmt, ...){
+    va_list args;
+    if(*len + 1 >= PAGE_SIZE_MAX){
+        return;
+    }
+    va_start(args, fmt);
+    int n = vsnprintf(page + *len, PAGE_SIZE_MAX - *len, fmt, args);
+    va_end(args);
+    if(n > 0){
+        *len = *len + n < PAGE_SIZE_MAX ? *len + n : PAGE_SIZE_MAX - 1;
+    }
+}
+
+static size_t render_api(char *page){
+    size_t len = 0;
+    time_t now = time(NULL);
+    int first = 1;
+
+    page_append(page, &len, "{\n  \"nodes\": [\n");
+    for(int i = 0; i < MAX_NODES; i++){
+        struct node *n = &nodes[i];
+        if(n->name[0] == '\0'){
+            continue;
+        }
+        page_append(page, &len, "%s    {\"node\": \"%s\", \"addr\": \"%s\", \"age_s\": %ld, \"seq\": %u, \"received\": %llu, \"lost\": %llu, \"no_base\": %llu, \"metrics\": {",
+                    first ? "" : ",\n", n->name, n->addr, (long)(now - n->last_seen), n->last_seq, n->received, n->lost, n->no_base);
+        for(int m = 0; m < FLEET_METRICS; m++){
+            page_append(page, &len, "%s\"%s\": %lld", m ? ", " : "", metric_names[m], (long long)n->values[m]);
+        }
+        page_append(page, &len, "}}");
+        first = 0;
+    }
+    page_append(page, &len, "\n  ],\n  \"bad_packets\": %llu\n}\n", bad_packets);
+    return len;
+}
+
+static size_t render_dashboard(char *page){
+    size_t len = 0;
+    time_t now = time(NULL);
+
+    page_append(page, &len, "<html>\n<head><title>Frota - Construção de Sistemas Operacionais</title></head>\n");
+    page_append(page, &len, "<meta http-equiv=\"refresh\" content=\"2\">\n<body>\n");
+    page_append(page, &len, "<h1>Painel da Frota</h1>\n<p>%d nós, %llu pacotes inválidos</p>\n<hr>\n", node_count, bad_packets);
+    page_append(page, &len, "<table border=\"1\" cellpadding=\"3\">\n<tr><th>Nó</th><th>Endereço</th><th>Idade (s)</th><th>Uptime (s)</th>"
+                            "<th>Carga (1/5/15)</th><th>CPU (%%)</th><th>Memória usada/total (MB)</th><th>Leituras/Escritas</th>"
+                            "<th>Rede rx/tx (MB)</th><th>PSI cpu/mem/io (%%)</th><th>CPU do monitor (%%)</th><th>Perdidos/Recebidos</th></tr>\n");
+    for(int i = 0; i < MAX_NODES; i++){
+        struct node *n = &nodes[i];
+        const int64_t *v = n->values;
+        if(n->name[0] == '\0'){
+            continue;
+        }
+        page_append(page, &len, "<tr%s><td>%s</td><td>%s</td><td>%ld</td><td>%lld</td><td>%.2f %.2f %.2f</td><td>%.2f</td>"
+                                "<td>%lld / %lld</td><td>%lld / %lld</td><td>%.1f / %.1f</td><td>%.2f / %.2f / %.2f</td><td>%.3f</td><td>%llu / %llu</td></tr>\n",
+                    now - n->last_seen > STALE_SECONDS ? " style=\"color:gray\"" : "",
+                    n->name, n->addr, (long)(now - n->last_seen), (long long)v[FLEET_UPTIME_S],
+                    v[FLEET_LOAD1] / 100.0, v[FLEET_LOAD5] / 100.0, v[FLEET_LOAD15] / 100.0, v[FLEET_CPU_USAGE] / 100.0,
+                    (long long)v[FLEET_MEM_USED_KB] / 1024, (long long)v[FLEET_MEM_TOTAL_KB] / 1024,
+                    (long long)v[FLEET_IO_READS], (long long)v[FLEET_IO_WRITES],
+                    v[FLEET_NET_RX_BYTES] / 1048576.0, v[FLEET_NET_TX_BYTES] / 1048576.0,
+                    v[FLEET_PSI_CPU] / 100.0, v[FLEET_PSI_MEMORY] / 100.0, v[FLEET_PSI_IO] / 100.0,
+                    v[FLEET_SELF_CPU] / 1000.0, n->lost, n->received);
+    }
+    page_append(page, &len, "</table>\n</body>\n</html>\n");
+    return len;
+}
+
+// Atende uma requisição HTTP curta: /api devolve JSON, qualquer outra rota o painel
+static void serve_http(int conn, char *page){
+    char buf[1024];
+    const char *header;
+    size_t len;
+    struct timeval tv = {1, 0};
+
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));  // Cliente lento não trava a recepção UDP
+    ssize_t n = read(conn, buf, sizeof(buf) - 1);
+    if(n <= 0){
+        return;
+    }
+    buf[n] = '\0';
+
+    if(strncmp(buf, "GET /api", 8) == 0){
+        header = "HTTP/1.0 200 OK\r\nContent-type: application/json\r\nServer: Fleet\r\n\r\n";
+        len = render_api(page);
+    }
+    else if(strncmp(buf, "GET", 3) == 0){
+        header = "HTTP/1.0 200 OK\r\nContent-type: text/html\r\nServer: Fleet\r\n\r\n";
+        len = render_dashboard(page);
+    }
+    else{
+        header = "HTTP/1.0 400 Bad Request\r\nContent-type: text/html\r\nServer: Fleet\r\n\r\n";
+        len = 0;
+    }
+    write(conn, header, strlen(header));
+    if(len > 0){
+        write(conn, page, len);
+    }
+}
+
+// Socket em todas as interfaces: IPv6 dual-stack (aceita também IPv4), ou só IPv4
+// se o kernel não tiver IPv6
+static int open_socket(int type, int port)
+{
+    struct sockaddr_in6 addr6;
+    struct sockaddr_in addr4;
+    int fd = socket(AF_INET6, type, 0);
+
+    if(fd >= 0){
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &(int){0}, sizeof(int));
+        memset(&addr6, 0, sizeof(addr6));
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_port = htons(port);
+        addr6.sin6_addr = in6addr_any;
+        if(type == SOCK_STREAM && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int)) < 0)
+            die("setsockopt(SO_REUSEADDR)");
+        if(bind(fd, (struct sockaddr *)&addr6, sizeof(addr6)) == -1)
+            die("bind");
+        return fd;
+    }
+    if(errno != EAFNOSUPPORT)
+        die("socket");
+
+    if((fd = socket(AF_INET, type, 0)) == -1)
+        die("socket");
+    memset(&addr4, 0, sizeof(addr4));
+    addr4.sin_family = AF_INET;
+    addr4.sin_port = htons(port);
+    addr4.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(type == SOCK_STREAM && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int)) < 0)
+        die("setsockopt(SO_REUSEADDR)");
+    if(bind(fd, (struct sockaddr *)&addr4, sizeof(addr4)) == -1)
+        die("bind");
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    int udp_port = FLEET_PORT, http_port = HTTP_PORT;
+    int udp, http;
+    char *page;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-u") == 0 && i + 1 < argc){
+            udp_port = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc){
+            http_port = atoi(argv[++i]);
+        }
+        else{
+            fprintf(stderr, "Uso: %s [-u porta_udp] [-p porta_http]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    page = malloc(PAGE_SIZE_MAX);
+    if(!page)
+        die("malloc");
+
+    /* UDP socket for the node reports, with a large receive buffer for bursts */
+    udp = open_socket(SOCK_DGRAM, udp_port);
+    setsockopt(udp, SOL_SOCKET, SO_RCVBUF, &(int){4 * 1024 * 1024}, sizeof(int));
+
+    /* TCP socket for the dashboard and the API */
+    http = open_socket(SOCK_STREAM, http_port);
+    if(listen(http, 10) == -1)
+        die("listen");
+
+    printf("Agregador: UDP %d, HTTP %d\n", udp_port, http_port);
+    fflush(stdout);
+
+    while(1){
+        struct pollfd fds[2] = {{udp, POLLIN, 0}, {http, POLLIN, 0}};
+        if(poll(fds, 2, -1) < 0){
+            if(errno == EINTR)
+                continue;
+            die("poll");
+        }
+        if(fds[0].revents & POLLIN){
+            receive_packets(udp);
+        }
+        if(fds[1].revents & POLLIN){
+            int conn = accept(http, NULL, NULL);
+            if(conn >= 0){
+                serve_http(conn, page);
+                close(conn);
+            }
+        }
+    }
+
+    free(page);
+    return 0;
+}
@@ -1,43 +1,61 @@
+/*
+	Directory tree indexer
+
+	Prints "size mtime path" for every entry below a directory (the
+	current one by default), walking it in parallel with dirwalk.
+	A summary with the entry count and the elapsed time goes to stderr.
+
+	usage: directory [-j threads] [dir]
+*/
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
-#include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
- 
-int main()
+#include <sys/stat.h>
+
+#include "dirwalk.h"
+
+int main(int argc, char *argv[])
 {
-	struct dirent *dir;
-	DIR *d;
-	int fd, size;
-	
-	d = opendir("./");
-	if (!d)
-		return -1;
-
-	while (dir = readdir(d)) {
-		if (dir-> d_type != DT_DIR) {
-			printf("file: %s\n", dir->d_name);
-			
-			if (strcmp(dir->d_name, "directory.c") == 0) {
-				char buf[4096];
-				
-				fd = open(dir->d_name, 0);
-				if (!fd)
-					return -1;
-					
-				size = read(fd, buf, sizeof(buf));
-				if (size) {
-					buf[size] = '\0';
-					printf("%s", buf);
-				}
-			}
-		} else {
-			if (dir -> d_type == DT_DIR && strcmp(dir->d_name, ".") != 0 && strcmp(dir->d_name, "..") != 0) {
-				printf("directory: %s\n", dir->d_name);
-			}
+	struct dirwalk_index idx;
+	struct timespec start, end;
+	const char *root = ".";
+	int threads = 0, opt, ret;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "j:")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-j threads] [dir]\n", argv[0]);
+			return 1;
 		}
 	}
-	closedir(d);
+	if (optind < argc)
+		root = argv[optind];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = dirwalk_index(root, threads, &idx);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (ret < 0) {
+		fprintf(stderr, "%s: %s\n", root, strerror(-ret));
+		return 1;
+	}
+
+	for (i = 0; i < idx.count; i++) {
+		struct dirwalk_entry *e = &idx.entries[i];
+
+		printf("%c %12lld %10lld %s\n", S_ISDIR(e->mode) ? 'd' : S_ISLNK(e->mode) ? 'l' : 'f',
+		       (long long)e->size, (long long)e->mtime.tv_sec, e->path);
+	}
+
+	fprintf(stderr, "%zu entries, %zu directories, %zu errors in %.3f s\n", idx.count, idx.dirs, idx.errors,
+		(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+	dirwalk_free(&idx);
 
 	return 0;
 }
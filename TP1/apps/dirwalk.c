@@ -0,0 +1,483 @@
+/*
+	Parallel recursive directory walker (see dirwalk.h)
+
+	Each worker owns a deque of directories to walk. It pushes the
+	subdirectories it finds and pops them back from the same end (depth
+	first, warm dentries); an idle worker steals from the opposite end of
+	another worker's deque, taking the oldest and usually largest subtrees.
+	The walk ends when no directory is queued or being walked.
+
+	A queued directory keeps a reference to its parent's open fd and is
+	opened with openat(parent, name, O_NOFOLLOW), so no path is resolved
+	twice and a symlink swapped in anywhere along the way is never
+	followed. A parent fd is closed once its last subdirectory is opened.
+	Workers with nothing to steal sleep on a condition variable.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "dirwalk.h"
+
+#define DENTS_BUFLEN	(256 * 1024)	/* getdents64 buffer per worker */
+#define MAX_THREADS	64
+#define VISITED_BITS	16		/* initial visited set: 64k directories */
+
+struct linux_dirent64 {
+	ino64_t d_ino;
+	off64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/* open directory shared by the tasks of its subdirectories */
+struct dir_handle {
+	int fd;
+	atomic_int refs;
+};
+
+struct task {
+	struct dir_handle *parent;	/* NULL for the walk root */
+	char *path;			/* full path, for the index and errors */
+	size_t name_off;		/* name within path, opened relative to parent */
+};
+
+struct deque {
+	pthread_mutex_t lock;
+	struct task **tasks;	/* owner uses the tail */
+	size_t head, tail, cap;
+};
+
+struct worker {
+	pthread_t thread;
+	int id;
+	struct walk *walk;
+	struct deque queue;
+	char *buf;
+	struct dirwalk_entry *entries;
+	size_t count, cap, dirs, errors;
+};
+
+struct walk {
+	struct worker workers[MAX_THREADS];
+	int nworkers;
+	atomic_long pending;	/* directories queued or being walked */
+	atomic_long queued;	/* directories sitting in a deque */
+
+	pthread_mutex_t idle_lock;
+	pthread_cond_t idle_cond;	/* work queued, or the walk is over */
+	atomic_int idle;		/* workers waiting on idle_cond */
+
+	pthread_mutex_t visited_lock;
+	struct { dev_t dev; ino_t ino; } *visited;
+	size_t visited_count, visited_cap;	/* open addressing, cap is a power of 2 */
+};
+
+static int deque_push(struct deque *q, struct task *t)
+{
+	pthread_mutex_lock(&q->lock);
+	if (q->tail == q->cap) {
+		/* compact stolen slots first, grow only when really full */
+		if (q->head > 0) {
+			memmove(q->tasks, q->tasks + q->head, (q->tail - q->head) * sizeof(*q->tasks));
+			q->tail -= q->head;
+			q->head = 0;
+		}
+		if (q->tail == q->cap) {
+			size_t cap = q->cap ? q->cap * 2 : 64;
+			struct task **tasks = realloc(q->tasks, cap * sizeof(*tasks));
+			if (!tasks) {
+				pthread_mutex_unlock(&q->lock);
+				return -ENOMEM;
+			}
+			q->tasks = tasks;
+			q->cap = cap;
+		}
+	}
+	q->tasks[q->tail++] = t;
+	pthread_mutex_unlock(&q->lock);
+	return 0;
+}
+
+static struct task *deque_pop(struct deque *q)
+{
+	struct task *t = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->tail > q->head)
+		t = q->tasks[--q->tail];
+	pthread_mutex_unlock(&q->lock);
+	return t;
+}
+
+static struct task *deque_steal(struct deque *q)
+{
+	struct task *t = NULL;
+
+	if (pthread_mutex_trylock(&q->lock))
+		return NULL;	/* busy victim, try another one */
+	if (q->tail > q->head)
+		t = q->tasks[q->head++];
+	pthread_mutex_unlock(&q->lock);
+	return t;
+}
+
+static void dir_handle_put(struct dir_handle *h)
+{
+	if (h && atomic_fetch_sub(&h->refs, 1) == 1) {
+		close(h->fd);
+		free(h);
+	}
+}
+
+static void task_free(struct task *t)
+{
+	dir_handle_put(t->parent);
+	free(t->path);
+	free(t);
+}
+
+/* wake one idle worker; pairs with the idle/queued checks in worker_main */
+static void wake_idle(struct walk *w, int all)
+{
+	if (!all && atomic_load(&w->idle) == 0)
+		return;
+	pthread_mutex_lock(&w->idle_lock);
+	if (all)
+		pthread_cond_broadcast(&w->idle_cond);
+	else
+		pthread_cond_signal(&w->idle_cond);
+	pthread_mutex_unlock(&w->idle_lock);
+}
+
+static int queue_task(struct worker *wk, struct task *t)
+{
+	struct walk *w = wk->walk;
+
+	atomic_fetch_add(&w->pending, 1);
+	if (deque_push(&wk->queue, t) < 0) {
+		atomic_fetch_sub(&w->pending, 1);
+		return -ENOMEM;
+	}
+	atomic_fetch_add(&w->queued, 1);
+	wake_idle(w, 0);
+	return 0;
+}
+
+static size_t visited_slot(struct walk *w, dev_t dev, ino_t ino)
+{
+	size_t h = (size_t)(ino * 0x9e3779b97f4a7c15ULL) ^ (size_t)dev;
+
+	h &= w->visited_cap - 1;
+	while (w->visited[h].ino && !(w->visited[h].dev == dev && w->visited[h].ino == ino))
+		h = (h + 1) & (w->visited_cap - 1);
+	return h;
+}
+
+/* returns 1 the first time a directory is seen, 0 afterwards, -ENOMEM on failure */
+static int visited_insert(struct walk *w, dev_t dev, ino_t ino)
+{
+	int ret = 1;
+	size_t h;
+
+	pthread_mutex_lock(&w->visited_lock);
+	if ((w->visited_count + 1) * 2 > w->visited_cap) {
+		size_t old_cap = w->visited_cap, i;
+		void *old = w->visited;
+
+		w->visited_cap *= 2;
+		w->visited = calloc(w->visited_cap, sizeof(*w->visited));
+		if (!w->visited) {
+			w->visited = old;
+			w->visited_cap = old_cap;
+			pthread_mutex_unlock(&w->visited_lock);
+			return -ENOMEM;
+		}
+		for (i = 0; i < old_cap; i++) {
+			typeof(w->visited) e = (typeof(w->visited))old + i;
+			if (e->ino)
+				w->visited[visited_slot(w, e->dev, e->ino)] = *e;
+		}
+		free(old);
+	}
+	h = visited_slot(w, dev, ino);
+	if (w->visited[h].ino) {
+		ret = 0;
+	} else {
+		w->visited[h].dev = dev;
+		w->visited[h].ino = ino;
+		w->visited_count++;
+	}
+	pthread_mutex_unlock(&w->visited_lock);
+	return ret;
+}
+
+static int add_entry(struct worker *wk, char *path, const struct stat *st)
+{
+	if (wk->count == wk->cap) {
+		size_t cap = wk->cap ? wk->cap * 2 : 1024;
+		struct dirwalk_entry *e = realloc(wk->entries, cap * sizeof(*e));
+		if (!e)
+			return -ENOMEM;
+		wk->entries = e;
+		wk->cap = cap;
+	}
+	wk->entries[wk->count].path = path;
+	wk->entries[wk->count].size = st->st_size;
+	wk->entries[wk->count].mtime = st->st_mtim;
+	wk->entries[wk->count].mode = st->st_mode;
+	wk->count++;
+	return 0;
+}
+
+static char *join_path(const char *dir, const char *name)
+{
+	size_t dlen = strlen(dir), nlen = strlen(name);
+	char *path = malloc(dlen + nlen + 2);
+
+	if (path) {
+		memcpy(path, dir, dlen);
+		path[dlen] = '/';
+		memcpy(path + dlen + 1, name, nlen + 1);
+	}
+	return path;
+}
+
+/* walk one directory: index its entries and queue its subdirectories */
+static void walk_dir(struct worker *wk, struct task *t)
+{
+	const char *dir = t->path;
+	struct dir_handle *self;
+	struct stat st;
+	long n;
+	int fd;
+
+	fd = openat(t->parent ? t->parent->fd : AT_FDCWD, dir + t->name_off,
+		    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	dir_handle_put(t->parent);	/* only needed to open this one */
+	t->parent = NULL;
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		wk->errors++;
+		return;
+	}
+	self = malloc(sizeof(*self));
+	if (!self) {
+		close(fd);
+		wk->errors++;
+		return;
+	}
+	self->fd = fd;
+	atomic_init(&self->refs, 1);	/* ours, dropped at the end of the walk */
+	wk->dirs++;
+
+	while ((n = syscall(SYS_getdents64, fd, wk->buf, DENTS_BUFLEN)) > 0) {
+		long pos = 0;
+
+		while (pos < n) {
+			struct linux_dirent64 *d = (struct linux_dirent64 *)(wk->buf + pos);
+			char *path;
+
+			pos += d->d_reclen;
+			if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+			    (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+				continue;
+
+			/* d_type may be DT_UNKNOWN, and we need size/mtime anyway */
+			if (fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+				fprintf(stderr, "%s/%s: %s\n", dir, d->d_name, strerror(errno));
+				wk->errors++;
+				continue;
+			}
+			path = join_path(dir, d->d_name);
+			if (!path || add_entry(wk, path, &st) < 0) {
+				free(path);
+				wk->errors++;
+				continue;
+			}
+			if (S_ISDIR(st.st_mode) && visited_insert(wk->walk, st.st_dev, st.st_ino) == 1) {
+				struct task *sub = malloc(sizeof(*sub));
+
+				if (sub) {
+					sub->parent = self;
+					sub->path = strdup(path);
+					sub->name_off = strlen(dir) + 1;
+					atomic_fetch_add(&self->refs, 1);
+				}
+				if (!sub || !sub->path || queue_task(wk, sub) < 0) {
+					if (sub)
+						task_free(sub);
+					wk->errors++;
+				}
+			}
+		}
+	}
+	if (n < 0) {
+		fprintf(stderr, "%s: getdents64: %s\n", dir, strerror(errno));
+		wk->errors++;
+	}
+	dir_handle_put(self);
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *wk = arg;
+	struct walk *w = wk->walk;
+	unsigned int seed = wk->id + 1;
+
+	while (1) {
+		struct task *t = deque_pop(&wk->queue);
+
+		if (!t) {
+			int i, victim = rand_r(&seed) % w->nworkers;
+
+			for (i = 0; i < w->nworkers && !t; i++)
+				t = deque_steal(&w->workers[(victim + i) % w->nworkers].queue);
+		}
+		if (!t) {
+			int done;
+
+			/* idle is raised before queued is checked, and queue_task
+			   bumps queued before reading idle: one of them sees the other */
+			pthread_mutex_lock(&w->idle_lock);
+			atomic_fetch_add(&w->idle, 1);
+			while (atomic_load(&w->queued) == 0 && atomic_load(&w->pending) > 0)
+				pthread_cond_wait(&w->idle_cond, &w->idle_lock);
+			atomic_fetch_sub(&w->idle, 1);
+			done = atomic_load(&w->pending) == 0;
+			pthread_mutex_unlock(&w->idle_lock);
+			if (done)
+				break;
+			continue;
+		}
+		atomic_fetch_sub(&w->queued, 1);
+		walk_dir(wk, t);
+		task_free(t);
+		if (atomic_fetch_sub(&w->pending, 1) == 1)
+			wake_idle(w, 1);	/* last directory: everyone leaves */
+	}
+	return NULL;
+}
+
+int dirwalk_index(const char *root, int threads, struct dirwalk_index *idx)
+{
+	struct walk *w;
+	struct stat st;
+	struct task *task;
+	size_t total = 0;
+	int i, ret = 0;
+
+	memset(idx, 0, sizeof(*idx));
+	if (stat(root, &st) < 0)
+		return -errno;
+	if (!S_ISDIR(st.st_mode))
+		return -ENOTDIR;
+
+	if (threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads <= 0)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		return -ENOMEM;
+	w->nworkers = threads;
+	w->visited_cap = 1 << VISITED_BITS;
+	w->visited = calloc(w->visited_cap, sizeof(*w->visited));
+	task = calloc(1, sizeof(*task));
+	if (task)
+		task->path = strdup(root);
+	if (!w->visited || !task || !task->path) {
+		if (task)
+			free(task->path);
+		free(task);
+		free(w->visited);
+		free(w);
+		return -ENOMEM;
+	}
+	pthread_mutex_init(&w->visited_lock, NULL);
+	pthread_mutex_init(&w->idle_lock, NULL);
+	pthread_cond_init(&w->idle_cond, NULL);
+	visited_insert(w, st.st_dev, st.st_ino);
+
+	for (i = 0; i < threads; i++) {
+		struct worker *wk = &w->workers[i];
+
+		wk->id = i;
+		wk->walk = w;
+		pthread_mutex_init(&wk->queue.lock, NULL);
+		wk->buf = malloc(DENTS_BUFLEN);
+		if (!wk->buf)
+			ret = -ENOMEM;
+	}
+
+	if (ret == 0)
+		ret = queue_task(&w->workers[0], task);
+	if (ret == 0) {
+		int started[MAX_THREADS] = {0};
+
+		task = NULL;
+		/* a thread that fails to start just leaves more work to the others */
+		for (i = 1; i < threads; i++)
+			started[i] = pthread_create(&w->workers[i].thread, NULL, worker_main, &w->workers[i]) == 0;
+		worker_main(&w->workers[0]);
+		for (i = 1; i < threads; i++)
+			if (started[i])
+				pthread_join(w->workers[i].thread, NULL);
+	}
+	if (task)
+		task_free(task);
+
+	/* merge the per-worker indexes */
+	for (i = 0; i < threads; i++)
+		total += w->workers[i].count;
+	idx->entries = malloc((total ? total : 1) * sizeof(*idx->entries));
+	if (!idx->entries && ret == 0)
+		ret = -ENOMEM;
+	for (i = 0; i < threads; i++) {
+		struct worker *wk = &w->workers[i];
+
+		if (idx->entries && wk->count) {
+			memcpy(idx->entries + idx->count, wk->entries, wk->count * sizeof(*wk->entries));
+			idx->count += wk->count;
+		} else if (!idx->entries) {
+			size_t j;
+			for (j = 0; j < wk->count; j++)
+				free(wk->entries[j].path);
+		}
+		idx->dirs += wk->dirs;
+		idx->errors += wk->errors;
+		free(wk->entries);
+		free(wk->queue.tasks);
+		free(wk->buf);
+		pthread_mutex_destroy(&wk->queue.lock);
+	}
+	pthread_mutex_destroy(&w->visited_lock);
+	pthread_mutex_destroy(&w->idle_lock);
+	pthread_cond_destroy(&w->idle_cond);
+	free(w->visited);
+	free(w);
+	return ret;
+}
+
+void dirwalk_free(struct dirwalk_index *idx)
+{
+	size_t i;
+
+	for (i = 0; i < idx->count; i++)
+		free(idx->entries[i].path);
+	free(idx->entries);
+	memset(idx, 0, sizeof(*idx));
+}
@@ -0,0 +1,35 @@
+/*
+	Parallel recursive directory walker
+
+	Walks a directory tree with openat/getdents64 and a pool of threads
+	that steal subdirectories from each other, producing a size/mtime index
+	of every entry. Symbolic links are indexed but never followed, and a
+	directory already visited (same device and inode, e.g. through a bind
+	mount) is not walked twice.
+*/
+
+#ifndef DIRWALK_H
+#define DIRWALK_H
+
+#include <sys/types.h>
+#include <time.h>
+
+struct dirwalk_entry {
+	char *path;		/* path relative to the walk root's parent */
+	off_t size;
+	struct timespec mtime;
+	mode_t mode;
+};
+
+struct dirwalk_index {
+	struct dirwalk_entry *entries;
+	size_t count;
+	size_t dirs;		/* directories walked */
+	size_t errors;		/* entries that could not be opened or stat'ed */
+};
+
+/* walk root with threads workers (0 = one per online CPU); returns 0 or -errno */
+int dirwalk_index(const char *root, int threads, struct dirwalk_index *idx);
+void dirwalk_free(struct dirwalk_index *idx);
+
+#endif
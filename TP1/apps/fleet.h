@@ -0,0 +1,164 @@
+// Protocolo de envio de métricas do monitor (hello) para o agregador da frota
+// Guilherme Specht
+//
+// Cada ciclo do hello vira um datagrama UDP pequeno:
+//   magic (2) | versão (1) | flags (1) | seq (4) | base_seq (4) | tamanho do nome (1) | nome |
+//   máscara das métricas presentes (4) | valores em varint zigzag
+// Os campos de 16/32 bits vão em ordem de rede. Um keyframe (FLEET_KEYFRAME) leva
+// todas as métricas com valor absoluto; os pacotes seguintes levam só as métricas
+// que mudaram, como diferença em relação ao último keyframe (base_seq). Como cada
+// delta depende apenas do keyframe, a perda de um delta não invalida os próximos;
+// o agregador detecta as perdas pelos buracos na sequência.
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define FLEET_MAGIC        0x464c   // "FL"
+#define FLEET_VERSION      1
+#define FLEET_PORT         9100     // Porta UDP padrão do agregador
+#define FLEET_NODE_LEN     32       // Tamanho máximo do nome do nó (com '\0')
+#define FLEET_KEYFRAME     0x01     // Flag: pacote com valores absolutos
+#define FLEET_KEYFRAME_INTERVAL 10  // Um keyframe a cada N pacotes
+#define FLEET_MAX_PACKET   512
+
+// Métricas enviadas (no máximo 32, uma por bit da máscara)
+enum fleet_metric {
+    FLEET_UPTIME_S,
+    FLEET_IDLE_S,
+    FLEET_LOAD1,             // Carga x100
+    FLEET_LOAD5,
+    FLEET_LOAD15,
+    FLEET_CPU_USAGE,         // Capacidade ocupada desde o boot, x100 (%)
+    FLEET_MEM_TOTAL_KB,
+    FLEET_MEM_USED_KB,
+    FLEET_IO_READS,
+    FLEET_IO_WRITES,
+    FLEET_NET_RX_BYTES,
+    FLEET_NET_TX_BYTES,
+    FLEET_PSI_CPU,           // PSI "some" avg10 x100 (%)
+    FLEET_PSI_MEMORY,
+    FLEET_PSI_IO,
+    FLEET_SELF_CPU,          // CPU do próprio monitor na janela, x1000 (%)
+    FLEET_METRICS
+};
+
+// Estado do lado que envia: o último keyframe é a base dos deltas
+struct fleet_encoder {
+    int64_t base[FLEET_METRICS];
+    uint32_t seq;            // Sequência do próximo pacote
+    uint32_t base_seq;       // Sequência do último keyframe
+};
+
+// Pacote decodificado
+struct fleet_packet {
+    uint8_t flags;
+    uint32_t seq, base_seq;
+    char node[FLEET_NODE_LEN];
+    uint32_t mask;           // Métricas presentes
+    int64_t values[FLEET_METRICS];  // Absolutos (keyframe) ou deltas
+};
+
+static inline size_t fleet_put_varint(uint8_t *p, int64_t value){
+    uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);  // zigzag: valores pequenos com sinal -> poucos bytes
+    size_t n = 0;
+    while(v >= 0x80){
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline int fleet_get_varint(const uint8_t *p, size_t len, size_t *pos, int64_t *value){
+    uint64_t v = 0;
+    for(int shift = 0; shift < 64 && *pos < len; shift += 7){
+        uint8_t b = p[(*pos)++];
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if(!(b & 0x80)){
+            *value = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Codifica um ciclo de métricas; devolve o tamanho do pacote
+static inline size_t fleet_encode(struct fleet_encoder *enc, const char *node, const int64_t *values, uint8_t *buf){
+    int keyframe = enc->seq % FLEET_KEYFRAME_INTERVAL == 0;
+    size_t node_len = strnlen(node, FLEET_NODE_LEN - 1);
+    uint32_t mask = 0, net32;
+    uint16_t net16 = htons(FLEET_MAGIC);
+    size_t pos = 0, mask_pos;
+
+    if(keyframe){
+        enc->base_seq = enc->seq;
+    }
+
+    memcpy(buf + pos, &net16, 2); pos += 2;
+    buf[pos++] = FLEET_VERSION;
+    buf[pos++] = keyframe ? FLEET_KEYFRAME : 0;
+    net32 = htonl(enc->seq); memcpy(buf + pos, &net32, 4); pos += 4;
+    net32 = htonl(enc->base_seq); memcpy(buf + pos, &net32, 4); pos += 4;
+    buf[pos++] = (uint8_t)node_len;
+    memcpy(buf + pos, node, node_len); pos += node_len;
+    mask_pos = pos; pos += 4;
+
+    for(int i = 0; i < FLEET_METRICS; i++){
+        if(keyframe){
+            pos += fleet_put_varint(buf + pos, values[i]);
+            mask |= 1u << i;
+        }
+        else if(values[i] != enc->base[i]){
+            pos += fleet_put_varint(buf + pos, values[i] - enc->base[i]);
+            mask |= 1u << i;
+        }
+    }
+    net32 = htonl(mask);
+    memcpy(buf + mask_pos, &net32, 4);
+
+    if(keyframe){
+        memcpy(enc->base, values, sizeof(enc->base));
+    }
+    enc->seq++;
+    return pos;
+}
+
+// Decodifica um datagrama; devolve -1 se estiver malformado
+static inline int fleet_decode(const uint8_t *buf, size_t len, struct fleet_packet *pkt){
+    uint16_t net16;
+    uint32_t net32;
+    size_t pos = 0, node_len;
+
+    if(len < 17){
+        return -1;
+    }
+    memcpy(&net16, buf, 2); pos += 2;
+    if(ntohs(net16) != FLEET_MAGIC || buf[pos++] != FLEET_VERSION){
+        return -1;
+    }
+    pkt->flags = buf[pos++];
+    memcpy(&net32, buf + pos, 4); pkt->seq = ntohl(net32); pos += 4;
+    memcpy(&net32, buf + pos, 4); pkt->base_seq = ntohl(net32); pos += 4;
+    node_len = buf[pos++];
+    if(node_len == 0 || node_len >= FLEET_NODE_LEN || pos + node_len + 4 > len){
+        return -1;
+    }
+    memcpy(pkt->node, buf + pos, node_len);
+    pkt->node[node_len] = '\0';
+    pos += node_len;
+    memcpy(&net32, buf + pos, 4); pkt->mask = ntohl(net32); pos += 4;
+
+    for(int i = 0; i < FLEET_METRICS; i++){
+        pkt->values[i] = 0;
+        if((pkt->mask & (1u << i)) && fleet_get_varint(buf, len, &pos, &pkt->values[i]) < 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#endif
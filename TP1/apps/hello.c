@@ -7,6 +7,106 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "../sysinfo/sysinfo.h"
+#include "fleet.h"
+
+// PRESSURE STALL INFORMATION E CGROUPS V2
+#define PSI_RESOURCES 3                 // cpu, memory e io
+#define MAX_CGROUPS 16                  // Número máximo de cgroups monitorados
+#define CGROUP_ROOT "/sys/fs/cgroup"    // Raiz da hierarquia unificada (v2)
+
+static const char *psi_resources[PSI_RESOURCES] = {"cpu", "memory", "io"};
+
+// Uma linha de /proc/pressure/* ("some" ou "full")
+struct psi_line {
+    double avg10, avg60, avg300;        // Médias móveis do kernel (%)
+    unsigned long long total;           // Tempo total em stall (us)
+};
+
+// Última amostra de um recurso, usada para calcular o delta do intervalo
+struct psi_state {
+    int valid;                          // Amostra anterior existe
+    int has_full;                       // Kernel expõe a linha "full" para o recurso
+    struct psi_line some, full;
+    double time;                        // Instante da amostra (s, monotônico)
+};
+
+// Contadores de um cgroup, lidos de cpu.stat, memory.current e io.stat
+struct cgroup_sample {
+    int has_cpu, has_mem, has_io;
+    unsigned long long usage_usec, user_usec, system_usec;
+    unsigned long long nr_throttled, throttled_usec;
+    unsigned long long mem_current;
+    unsigned long long rbytes, wbytes, rios, wios;
+    double time;
+};
+
+// Cgroup configurado e sua amostra anterior
+struct cgroup_state {
+    char path[256];                     // Caminho absoluto do cgroup
+    int valid;                          // Amostra anterior existe
+    struct cgroup_sample prev;
+};
+
+static struct psi_state psi_prev[PSI_RESOURCES];
+static struct cgroup_state cgroup_list[MAX_CGROUPS];
+static int cgroup_count = 0;
+
+// SNAPSHOT BINÁRIO DO MÓDULO SYSINFO
+// Com o módulo carregado, um único read de /dev/sysinfo substitui a leitura e o
+// parsing de uptime, loadavg, stat, meminfo, diskstats e net/dev.
+static struct sysinfo_snapshot snapshot;
+static int snapshot_valid = 0;
+static int sysinfo_fd = -2;             // -2: ainda não tentou abrir; -1: módulo ausente
+
+// ENVIO PARA O AGREGADOR DA FROTA (--push)
+// Os coletores guardam aqui os valores numéricos que vão no datagrama
+static int64_t fleet_values[FLEET_METRICS];
+static struct fleet_encoder fleet_enc;
+static int fleet_fd = -1;               // Socket UDP conectado ao agregador
+static char fleet_node[FLEET_NODE_LEN];
+
+// Concatena texto formatado ao final do buffer sem estourar o tamanho
+static void buffer_append(char *buf, size_t size, const char *fmt, ...){
+    size_t len = strlen(buf);
+    if(len + 1 >= size){
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+}
+
+// Relógio monotônico em segundos (imune a ajustes de data e hora)
+static double monotonic_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// SNAPSHOT DO /dev/sysinfo (os coletores abaixo voltam ao /proc se não houver)
+void get_sysinfo_snapshot(void){
+    snapshot_valid = 0;
+    if(sysinfo_fd == -2){
+        sysinfo_fd = open(SYSINFO_DEVICE, O_RDONLY);
+    }
+    if(sysinfo_fd < 0){
+        return;
+    }
+    // pread na posição 0: depois de um snapshot o dispositivo está no fim do arquivo
+    if(pread(sysinfo_fd, &snapshot, sizeof(snapshot), 0) == sizeof(snapshot) &&
+       snapshot.magic == SYSINFO_MAGIC && snapshot.version == SYSINFO_VERSION && snapshot.size == sizeof(snapshot)){
+        snapshot_valid = 1;
+    }
+}
 
 // VERSÃO DO SISTEMA E KERNEL
 void get_system_version(char *version, size_t size){
@@ -22,10 +122,19 @@ void get_system_version(char *version, size_t size){
 
 // UPTIME E TEMPO OCIOSO
 void get_uptime_and_idle_time(char *uptime_buffer, char *idle_buffer, size_t size){
-    FILE *file = fopen("/proc/uptime", "r");
-    if(file){
-        double uptime, idle_time;
+    double uptime, idle_time;
+    FILE *file = NULL;
+    if(snapshot_valid){
+        uptime = snapshot.uptime_ns / 1e9;
+        idle_time = snapshot.idle_ns / 1e9;
+    }
+    else if((file = fopen("/proc/uptime", "r")) != NULL){
         fscanf(file, "%lf %lf", &uptime, &idle_time);
+        fclose(file);
+    }
+    if(snapshot_valid || file){
+        fleet_values[FLEET_UPTIME_S] = (int64_t)uptime;
+        fleet_values[FLEET_IDLE_S] = (int64_t)idle_time;
         int uptime_days = uptime / 86400;
         int uptime_hours = ((int)uptime % 86400) / 3600;
         int uptime_minutes = ((int)uptime % 3600) / 60;
@@ -36,7 +145,6 @@ void get_uptime_and_idle_time(char *uptime_buffer, char *idle_buffer, size_t siz
         int idle_seconds = (int)idle_time % 60;
         snprintf(uptime_buffer, size, "%d dias, %d horas, %d minutos e %d segundos", uptime_days, uptime_hours, uptime_minutes, uptime_seconds);
         snprintf(idle_buffer, size, "%d dias, %d horas, %d minutos e %d segundos", idle_days, idle_hours, idle_minutes, idle_seconds);
-        fclose(file);
     }
     else{
         snprintf(uptime_buffer, size, "ERRO NO UPTIME!");
@@ -77,9 +185,23 @@ void get_cpu_info(char *model, size_t model_size, int *cores, char *speed, size_
 
 // CARGA DO SISTEMA
 void get_load_average(char *lavg, size_t size){
+    if(snapshot_valid){
+        snprintf(lavg, size, "%.2f %.2f %.2f", (double)snapshot.load[0] / SYSINFO_LOAD_SCALE,
+                 (double)snapshot.load[1] / SYSINFO_LOAD_SCALE, (double)snapshot.load[2] / SYSINFO_LOAD_SCALE);
+        for(int i = 0; i < 3; i++){
+            fleet_values[FLEET_LOAD1 + i] = snapshot.load[i] * 100 / SYSINFO_LOAD_SCALE;
+        }
+        return;
+    }
     FILE *file = fopen("/proc/loadavg", "r");
     if(file){
+        double load[3];
         fgets(lavg, size, file);
+        if(sscanf(lavg, "%lf %lf %lf", &load[0], &load[1], &load[2]) == 3){
+            for(int i = 0; i < 3; i++){
+                fleet_values[FLEET_LOAD1 + i] = (int64_t)(load[i] * 100 + 0.5);
+            }
+        }
         fclose(file);
     }
     else{
@@ -89,6 +211,15 @@ void get_load_average(char *lavg, size_t size){
 
 // CAPACIDADE OCUPADA DO PROCESSADOR
 void get_cpu_usage(char *cpu_usage, size_t size){
+    if(snapshot_valid){
+        const unsigned long long *t = snapshot.cpu_total.time;
+        unsigned long long usage = t[SYSINFO_CPU_USER] + t[SYSINFO_CPU_NICE] + t[SYSINFO_CPU_SYSTEM];
+        unsigned long long total = usage + t[SYSINFO_CPU_IDLE];
+        double usage_percent = total ? (double)usage / total * 100 : 0.0;
+        snprintf(cpu_usage, size, "%.2f%%", usage_percent);
+        fleet_values[FLEET_CPU_USAGE] = (int64_t)(usage_percent * 100);
+        return;
+    }
     FILE *file = fopen("/proc/stat", "r");
     if(file){
         long user, nice, system, idle;
@@ -97,6 +228,7 @@ void get_cpu_usage(char *cpu_usage, size_t size){
         long usage = user + nice + system;
         double usage_percent = (double)usage / total * 100;
         snprintf(cpu_usage, size, "%.2f%%", usage_percent);
+        fleet_values[FLEET_CPU_USAGE] = (int64_t)(usage_percent * 100);
         fclose(file);
     } 
     else{
@@ -106,6 +238,13 @@ void get_cpu_usage(char *cpu_usage, size_t size){
 
 // QUANTIDADE DE MEMÓRIA RAM TOTAL E USADA
 void get_memory_info(char *mem_info, size_t size){
+    if(snapshot_valid){
+        snprintf(mem_info, size, "Total: %llu MB, Usada: %llu MB", snapshot.mem_total_kb / 1024,
+                 (snapshot.mem_total_kb - snapshot.mem_available_kb) / 1024);
+        fleet_values[FLEET_MEM_TOTAL_KB] = snapshot.mem_total_kb;
+        fleet_values[FLEET_MEM_USED_KB] = snapshot.mem_total_kb - snapshot.mem_available_kb;
+        return;
+    }
     FILE *file = fopen("/proc/meminfo", "r");
     if(file){
         char line[256];
@@ -119,6 +258,8 @@ void get_memory_info(char *mem_info, size_t size){
             }
         }
         snprintf(mem_info, size, "Total: %lu MB, Usada: %lu MB", total_memory / 1024, (total_memory - free_memory) / 1024);
+        fleet_values[FLEET_MEM_TOTAL_KB] = total_memory;
+        fleet_values[FLEET_MEM_USED_KB] = total_memory - free_memory;
         fclose(file);
     }
     else{
@@ -128,6 +269,17 @@ void get_memory_info(char *mem_info, size_t size){
 
 // OPERAÇÕES SOBRE O SISTEMA DE I/O
 void get_io_info(char *io_info, size_t size){
+    if(snapshot_valid){
+        unsigned long long reads = 0, writes = 0;
+        for(unsigned int i = 0; i < snapshot.nr_disks; i++){
+            reads += snapshot.disks[i].reads;
+            writes += snapshot.disks[i].writes;
+        }
+        snprintf(io_info, size, "Leituras: %llu, Escritas: %llu", reads, writes);
+        fleet_values[FLEET_IO_READS] = reads;
+        fleet_values[FLEET_IO_WRITES] = writes;
+        return;
+    }
     FILE *file = fopen("/proc/diskstats", "r");
     if(file){
         char line[256];
@@ -139,6 +291,8 @@ void get_io_info(char *io_info, size_t size){
             writes += w;
         }
         snprintf(io_info, size, "Leituras: %lu, Escritas: %lu", reads, writes);
+        fleet_values[FLEET_IO_READS] = reads;
+        fleet_values[FLEET_IO_WRITES] = writes;
         fclose(file);
     }
     else{
@@ -180,14 +334,33 @@ void get_device_info(char *dev_info, size_t size){
 
 // DISPOSITIVO DE REDE
 void get_network_devices(char *net_dev, size_t size){
+    if(snapshot_valid){
+        net_dev[0] = '\0';
+        fleet_values[FLEET_NET_RX_BYTES] = fleet_values[FLEET_NET_TX_BYTES] = 0;
+        for(unsigned int i = 0; i < snapshot.nr_netdevs; i++){
+            const struct sysinfo_netdev *n = &snapshot.netdevs[i];
+            fleet_values[FLEET_NET_RX_BYTES] += n->rx_bytes;
+            fleet_values[FLEET_NET_TX_BYTES] += n->tx_bytes;
+            buffer_append(net_dev, size, "%6s: %10llu %8llu %4llu %4llu  %10llu %8llu %4llu %4llu\n", n->name,
+                          n->rx_bytes, n->rx_packets, n->rx_errors, n->rx_dropped,
+                          n->tx_bytes, n->tx_packets, n->tx_errors, n->tx_dropped);
+        }
+        return;
+    }
     FILE *file = fopen("/proc/net/dev", "r");
     if(file){
         char line[256];
         net_dev[0] = '\0';
         fgets(line, sizeof(line), file);  // Pula o header
         fgets(line, sizeof(line), file);
+        fleet_values[FLEET_NET_RX_BYTES] = fleet_values[FLEET_NET_TX_BYTES] = 0;
         while (fgets(line, sizeof(line), file)) {
+            unsigned long long rx, tx;
             strncat(net_dev, line, size - strlen(net_dev) - 1);
+            if(sscanf(line, "%*[^:]: %llu %*u %*u %*u %*u %*u %*u %*u %llu", &rx, &tx) == 2){
+                fleet_values[FLEET_NET_RX_BYTES] += rx;
+                fleet_values[FLEET_NET_TX_BYTES] += tx;
+            }
         }
         fclose(file);
     }
@@ -212,6 +385,467 @@ void get_process_list(char *pl, size_t size){
     }
 }
 
+// PRESSURE STALL INFORMATION (/proc/pressure)
+static int read_psi_file(const char *path, struct psi_state *st){
+    FILE *file = fopen(path, "r");
+    if(!file){
+        return -1;
+    }
+    char line[256];
+    int found = 0;
+    st->has_full = 0;
+    while(fgets(line, sizeof(line), file)){
+        struct psi_line l;
+        if(sscanf(line, "some avg10=%lf avg60=%lf avg300=%lf total=%llu", &l.avg10, &l.avg60, &l.avg300, &l.total) == 4){
+            st->some = l;
+            found = 1;
+        }
+        else if(sscanf(line, "full avg10=%lf avg60=%lf avg300=%lf total=%llu", &l.avg10, &l.avg60, &l.avg300, &l.total) == 4){
+            st->full = l;
+            st->has_full = 1;
+        }
+    }
+    fclose(file);
+    return found ? 0 : -1;
+}
+
+// Percentual do intervalo em que houve stall, a partir do delta de "total"
+static double psi_interval_percent(unsigned long long now, unsigned long long prev, double elapsed){
+    if(elapsed <= 0 || now < prev){
+        return 0.0;
+    }
+    return (double)(now - prev) / (elapsed * 1e6) * 100;
+}
+
+void get_pressure_info(char *psi, size_t size){
+    psi[0] = '\0';
+    for(int i = 0; i < PSI_RESOURCES; i++){
+        char path[64];
+        struct psi_state cur;
+        snprintf(path, sizeof(path), "/proc/pressure/%s", psi_resources[i]);
+        if(read_psi_file(path, &cur) < 0){
+            buffer_append(psi, size, "%-7s ERRO NA LEITURA DE %s!\n", psi_resources[i], path);
+            psi_prev[i].valid = 0;
+            continue;
+        }
+        cur.time = monotonic_seconds();
+        cur.valid = 1;
+        fleet_values[FLEET_PSI_CPU + i] = (int64_t)(cur.some.avg10 * 100);
+
+        struct psi_state *prev = &psi_prev[i];
+        double elapsed = cur.time - prev->time;
+        buffer_append(psi, size, "%-7s some: avg10=%.2f%% avg60=%.2f%% avg300=%.2f%%", psi_resources[i], cur.some.avg10, cur.some.avg60, cur.some.avg300);
+        if(prev->valid){
+            buffer_append(psi, size, " intervalo=%.2f%%", psi_interval_percent(cur.some.total, prev->some.total, elapsed));
+        }
+        if(cur.has_full){
+            buffer_append(psi, size, " | full: avg10=%.2f%% avg60=%.2f%% avg300=%.2f%%", cur.full.avg10, cur.full.avg60, cur.full.avg300);
+            if(prev->valid && prev->has_full){
+                buffer_append(psi, size, " intervalo=%.2f%%", psi_interval_percent(cur.full.total, prev->full.total, elapsed));
+            }
+        }
+        buffer_append(psi, size, "\n");
+        *prev = cur;
+    }
+}
+
+// RECURSOS POR CGROUP (cgroup v2)
+int add_cgroup(const char *name){
+    if(cgroup_count >= MAX_CGROUPS){
+        return -1;
+    }
+    struct cgroup_state *cg = &cgroup_list[cgroup_count];
+    if(strncmp(name, CGROUP_ROOT, strlen(CGROUP_ROOT)) == 0){
+        snprintf(cg->path, sizeof(cg->path), "%s", name);  // Caminho já absoluto
+    }
+    else{
+        while(name[0] == '/'){
+            name++;
+        }
+        if(name[0] == '\0'){
+            snprintf(cg->path, sizeof(cg->path), "%s", CGROUP_ROOT);  // Cgroup raiz
+        }
+        else{
+            snprintf(cg->path, sizeof(cg->path), "%s/%s", CGROUP_ROOT, name);
+        }
+    }
+    cg->valid = 0;
+    cgroup_count++;
+    return 0;
+}
+
+// Abre um arquivo de interface do cgroup; NULL se não existir ou se o caminho não couber
+static FILE *open_cgroup_file(const char *dir, const char *name){
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if(len < 0 || (size_t)len >= sizeof(path)){
+        return NULL;
+    }
+    return fopen(path, "r");
+}
+
+static void read_cgroup_sample(const char *dir, struct cgroup_sample *s){
+    char line[512];
+    FILE *file;
+
+    memset(s, 0, sizeof(*s));
+    s->time = monotonic_seconds();
+
+    file = open_cgroup_file(dir, "cpu.stat");
+    if(file){
+        char key[64];
+        unsigned long long value;
+        while(fgets(line, sizeof(line), file)){
+            if(sscanf(line, "%63s %llu", key, &value) != 2){
+                continue;
+            }
+            if(strcmp(key, "usage_usec") == 0) s->usage_usec = value;
+            else if(strcmp(key, "user_usec") == 0) s->user_usec = value;
+            else if(strcmp(key, "system_usec") == 0) s->system_usec = value;
+            else if(strcmp(key, "nr_throttled") == 0) s->nr_throttled = value;
+            else if(strcmp(key, "throttled_usec") == 0) s->throttled_usec = value;
+        }
+        s->has_cpu = 1;
+        fclose(file);
+    }
+
+    file = open_cgroup_file(dir, "memory.current");
+    if(file){
+        if(fscanf(file, "%llu", &s->mem_current) == 1){
+            s->has_mem = 1;
+        }
+        fclose(file);
+    }
+
+    // Cada linha: "MAJ:MIN rbytes=N wbytes=N rios=N wios=N dbytes=N dios=N"
+    file = open_cgroup_file(dir, "io.stat");
+    if(file){
+        while(fgets(line, sizeof(line), file)){
+            char *tok = strtok(line, " \n");
+            while((tok = strtok(NULL, " \n")) != NULL){
+                unsigned long long value;
+                if(sscanf(tok, "rbytes=%llu", &value) == 1) s->rbytes += value;
+                else if(sscanf(tok, "wbytes=%llu", &value) == 1) s->wbytes += value;
+                else if(sscanf(tok, "rios=%llu", &value) == 1) s->rios += value;
+                else if(sscanf(tok, "wios=%llu", &value) == 1) s->wios += value;
+            }
+        }
+        s->has_io = 1;
+        fclose(file);
+    }
+}
+
+// Taxa por segundo de um contador entre duas amostras
+static double counter_rate(unsigned long long now, unsigned long long prev, double elapsed){
+    if(elapsed <= 0 || now < prev){
+        return 0.0;
+    }
+    return (double)(now - prev) / elapsed;
+}
+
+void get_cgroup_info(char *cgi, size_t size){
+    cgi[0] = '\0';
+    for(int i = 0; i < cgroup_count; i++){
+        struct cgroup_state *cg = &cgroup_list[i];
+        struct cgroup_sample cur;
+        read_cgroup_sample(cg->path, &cur);
+
+        buffer_append(cgi, size, "%s\n", cg->path);
+        if(!cur.has_cpu && !cur.has_mem && !cur.has_io){
+            buffer_append(cgi, size, "  ERRO NA LEITURA DO CGROUP!\n");
+            cg->valid = 0;
+            continue;
+        }
+
+        struct cgroup_sample *prev = &cg->prev;
+        double elapsed = cur.time - prev->time;
+        int delta = cg->valid;
+
+        if(cur.has_cpu){
+            buffer_append(cgi, size, "  CPU: total %.2f s (user %.2f s, system %.2f s), throttled %llu vezes",
+                          cur.usage_usec / 1e6, cur.user_usec / 1e6, cur.system_usec / 1e6, cur.nr_throttled);
+            if(delta && prev->has_cpu){
+                buffer_append(cgi, size, " | intervalo: uso %.2f%%, throttled %.2f%%",
+                              counter_rate(cur.usage_usec, prev->usage_usec, elapsed) / 1e6 * 100,
+                              counter_rate(cur.throttled_usec, prev->throttled_usec, elapsed) / 1e6 * 100);
+            }
+            buffer_append(cgi, size, "\n");
+        }
+        if(cur.has_mem){
+            buffer_append(cgi, size, "  Memória: %llu MB\n", cur.mem_current / (1024 * 1024));
+        }
+        if(cur.has_io){
+            buffer_append(cgi, size, "  I/O: lidos %llu MB (%llu ops), escritos %llu MB (%llu ops)",
+                          cur.rbytes / (1024 * 1024), cur.rios, cur.wbytes / (1024 * 1024), cur.wios);
+            if(delta && prev->has_io){
+                buffer_append(cgi, size, " | intervalo: leitura %.1f KB/s (%.1f IOPS), escrita %.1f KB/s (%.1f IOPS)",
+                              counter_rate(cur.rbytes, prev->rbytes, elapsed) / 1024,
+                              counter_rate(cur.rios, prev->rios, elapsed),
+                              counter_rate(cur.wbytes, prev->wbytes, elapsed) / 1024,
+                              counter_rate(cur.wios, prev->wios, elapsed));
+            }
+            buffer_append(cgi, size, "\n");
+        }
+        *prev = cur;
+        cg->valid = 1;
+    }
+}
+
+// INSTRUMENTAÇÃO DO CICLO DE COLETA
+#define STATS_WINDOW 256                // Amostras mantidas por estatística (janela deslizante)
+
+enum collector_id {
+    COL_SNAPSHOT, COL_VERSION, COL_UPTIME, COL_DATETIME, COL_CPU_INFO, COL_LOAD_AVG, COL_CPU_USAGE,
+    COL_MEMORY, COL_IO, COL_FILESYSTEMS, COL_DEVICES, COL_NETWORK, COL_PROCESSES,
+    COL_PRESSURE, COL_CGROUPS, COL_OUTPUT, COL_CYCLE, COLLECTORS
+};
+
+static const char *collector_names[COLLECTORS] = {
+    "get_sysinfo_snapshot", "get_system_version", "get_uptime_and_idle_time", "get_datetime", "get_cpu_info",
+    "get_load_average", "get_cpu_usage", "get_memory_info", "get_io_info",
+    "get_filesystems", "get_device_info", "get_network_devices", "get_process_list",
+    "get_pressure_info", "get_cgroup_info", "saida (html/json)", "ciclo completo"
+};
+
+// Janela circular de amostras (latência em ns, CPU em us, syscalls...)
+struct window_stats {
+    unsigned long long samples[STATS_WINDOW];
+    int count;                          // Amostras válidas na janela
+    int next;                           // Próxima posição a ser escrita
+};
+
+struct window_summary {
+    unsigned long long min, max, p99;
+    double avg;
+    int count;
+};
+
+// Custo do próprio monitor por ciclo
+struct self_overhead {
+    struct window_stats cpu_us;         // CPU (user + system, incluindo filhos do popen) por ciclo
+    struct window_stats syscalls;       // Syscalls de leitura e escrita por ciclo (/proc/self/io)
+    double cycle_time[STATS_WINDOW];    // Fim de cada ciclo (s, monotônico)
+    unsigned long long cycle_cpu[STATS_WINDOW];  // CPU acumulada no fim de cada ciclo (us)
+    long maxrss_kb;                     // Pico de memória residente
+    unsigned long long cycles;          // Ciclos executados
+};
+
+static struct window_stats collector_stats[COLLECTORS];
+static struct self_overhead overhead;
+
+static unsigned long long monotonic_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void window_record(struct window_stats *w, unsigned long long value){
+    w->samples[w->next] = value;
+    w->next = (w->next + 1) % STATS_WINDOW;
+    if(w->count < STATS_WINDOW){
+        w->count++;
+    }
+}
+
+static int compare_ull(const void *a, const void *b){
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void window_summarize(const struct window_stats *w, struct window_summary *sum){
+    unsigned long long sorted[STATS_WINDOW];
+    unsigned long long total = 0;
+
+    memset(sum, 0, sizeof(*sum));
+    sum->count = w->count;
+    if(w->count == 0){
+        return;
+    }
+    memcpy(sorted, w->samples, w->count * sizeof(sorted[0]));
+    qsort(sorted, w->count, sizeof(sorted[0]), compare_ull);
+    for(int i = 0; i < w->count; i++){
+        total += sorted[i];
+    }
+    sum->min = sorted[0];
+    sum->max = sorted[w->count - 1];
+    sum->avg = (double)total / w->count;
+    sum->p99 = sorted[(w->count * 99 + 99) / 100 - 1];  // Percentil 99 (nearest-rank)
+}
+
+// Executa um coletor medindo sua latência com o relógio monotônico
+#define TIMED(id, call) do { \
+        unsigned long long timed_start = monotonic_ns(); \
+        call; \
+        window_record(&collector_stats[id], monotonic_ns() - timed_start); \
+    } while(0)
+
+// CPU consumida pelo monitor e pelos filhos já encerrados (ps do popen), em us
+static unsigned long long self_cpu_us(long *maxrss_kb){
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    if(maxrss_kb){
+        *maxrss_kb = self.ru_maxrss;
+    }
+    return (unsigned long long)(self.ru_utime.tv_sec + self.ru_stime.tv_sec + children.ru_utime.tv_sec + children.ru_stime.tv_sec) * 1000000ULL
+           + self.ru_utime.tv_usec + self.ru_stime.tv_usec + children.ru_utime.tv_usec + children.ru_stime.tv_usec;
+}
+
+// Syscalls de leitura e escrita feitas pelo monitor até agora (syscr + syscw)
+static unsigned long long self_syscalls(void){
+    FILE *file = fopen("/proc/self/io", "r");
+    unsigned long long total = 0, value;
+    char line[128];
+    if(!file){
+        return 0;
+    }
+    while(fgets(line, sizeof(line), file)){
+        if(sscanf(line, "syscr: %llu", &value) == 1 || sscanf(line, "syscw: %llu", &value) == 1){
+            total += value;
+        }
+    }
+    fclose(file);
+    return total;
+}
+
+// Registra o custo de um ciclo e a CPU acumulada para a taxa da janela
+static void overhead_record_cycle(unsigned long long cpu_before, unsigned long long sys_before){
+    unsigned long long cpu_now = self_cpu_us(&overhead.maxrss_kb);
+    int slot = overhead.cycles % STATS_WINDOW;
+
+    window_record(&overhead.cpu_us, cpu_now - cpu_before);
+    window_record(&overhead.syscalls, self_syscalls() - sys_before);
+    overhead.cycle_time[slot] = monotonic_seconds();
+    overhead.cycle_cpu[slot] = cpu_now;
+    overhead.cycles++;
+}
+
+// Percentual de uma CPU usado pelo monitor ao longo da janela (inclui o tempo dormindo)
+static double overhead_cpu_percent(void){
+    if(overhead.cycles < 2){
+        return 0.0;
+    }
+    int newest = (overhead.cycles - 1) % STATS_WINDOW;
+    int oldest = overhead.cycles > STATS_WINDOW ? overhead.cycles % STATS_WINDOW : 0;
+    double elapsed = overhead.cycle_time[newest] - overhead.cycle_time[oldest];
+    if(elapsed <= 0){
+        return 0.0;
+    }
+    return (overhead.cycle_cpu[newest] - overhead.cycle_cpu[oldest]) / (elapsed * 1e6) * 100;
+}
+
+// Tabela com o custo de cada coletor e do monitor (usada no HTML e no --bench)
+static void format_overhead_report(char *report, size_t size){
+    struct window_summary sum, cpu, sys;
+    double collectors_avg = 0;
+
+    for(int i = 0; i < COL_OUTPUT; i++){
+        window_summarize(&collector_stats[i], &sum);
+        collectors_avg += sum.avg;
+    }
+
+    report[0] = '\0';
+    buffer_append(report, size, "%-26s %8s %10s %10s %10s %10s %7s\n", "coletor", "amostras", "min (us)", "media (us)", "max (us)", "p99 (us)", "parcela");
+    for(int i = 0; i < COLLECTORS; i++){
+        window_summarize(&collector_stats[i], &sum);
+        buffer_append(report, size, "%-26s %8d %10.1f %10.1f %10.1f %10.1f",
+                      collector_names[i], sum.count, sum.min / 1e3, sum.avg / 1e3, sum.max / 1e3, sum.p99 / 1e3);
+        if(i < COL_OUTPUT && collectors_avg > 0){
+            buffer_append(report, size, " %6.1f%%", sum.avg / collectors_avg * 100);
+        }
+        buffer_append(report, size, "\n");
+    }
+
+    window_summarize(&overhead.cpu_us, &cpu);
+    window_summarize(&overhead.syscalls, &sys);
+    buffer_append(report, size, "\nCiclos: %llu (janela de %d)\n", overhead.cycles, cpu.count);
+    buffer_append(report, size, "CPU por ciclo (us): min %llu, media %.1f, max %llu, p99 %llu\n", cpu.min, cpu.avg, cpu.max, cpu.p99);
+    buffer_append(report, size, "Syscalls de leitura/escrita por ciclo: min %llu, media %.1f, max %llu, p99 %llu\n", sys.min, sys.avg, sys.max, sys.p99);
+    buffer_append(report, size, "CPU do monitor na janela: %.3f%% de um núcleo\n", overhead_cpu_percent());
+    buffer_append(report, size, "Pico de memória residente: %ld KB\n", overhead.maxrss_kb);
+}
+
+// API: mesmas medidas em JSON, escritas em arquivo temporário e renomeadas (atômico para o servidor)
+static void write_api_file(void){
+    struct window_summary sum, cpu, sys;
+    FILE *json_file = fopen("api.json.tmp", "w");
+    if(!json_file){
+        perror("ERRO AO ABRIR O ARQUIVO DA API!");
+        return;
+    }
+
+    window_summarize(&overhead.cpu_us, &cpu);
+    window_summarize(&overhead.syscalls, &sys);
+    fprintf(json_file, "{\n  \"overhead\": {\n");
+    fprintf(json_file, "    \"cycles\": %llu,\n", overhead.cycles);
+    fprintf(json_file, "    \"cpu_percent\": %.3f,\n", overhead_cpu_percent());
+    fprintf(json_file, "    \"cpu_us_per_cycle\": {\"min\": %llu, \"avg\": %.1f, \"max\": %llu, \"p99\": %llu},\n", cpu.min, cpu.avg, cpu.max, cpu.p99);
+    fprintf(json_file, "    \"syscalls_per_cycle\": {\"min\": %llu, \"avg\": %.1f, \"max\": %llu, \"p99\": %llu},\n", sys.min, sys.avg, sys.max, sys.p99);
+    fprintf(json_file, "    \"maxrss_kb\": %ld,\n", overhead.maxrss_kb);
+    fprintf(json_file, "    \"collectors\": [\n");
+    for(int i = 0; i < COLLECTORS; i++){
+        window_summarize(&collector_stats[i], &sum);
+        fprintf(json_file, "      {\"name\": \"%s\", \"samples\": %d, \"min_ns\": %llu, \"avg_ns\": %.0f, \"max_ns\": %llu, \"p99_ns\": %llu}%s\n",
+                collector_names[i], sum.count, sum.min, sum.avg, sum.max, sum.p99, i + 1 < COLLECTORS ? "," : "");
+    }
+    fprintf(json_file, "    ]\n  }\n}\n");
+    fclose(json_file);
+    rename("api.json.tmp", "api.json");
+}
+
+// Abre o socket UDP para o agregador em "host[:porta]"; IPv6 literal como "[addr]:porta" ou "addr"
+static int fleet_connect(const char *target){
+    char host[256];
+    char port[16];
+    const char *colon = strrchr(target, ':');
+    struct addrinfo hints, *res;
+
+    if(target[0] == '['){
+        const char *end = strchr(target, ']');
+        if(!end || (end[1] != '\0' && end[1] != ':')){
+            return -1;
+        }
+        snprintf(host, sizeof(host), "%.*s", (int)(end - target - 1), target + 1);
+        snprintf(port, sizeof(port), "%s", end[1] == ':' ? end + 2 : "");
+        if(port[0] == '\0'){
+            snprintf(port, sizeof(port), "%d", FLEET_PORT);
+        }
+    }
+    else if(colon && strchr(target, ':') == colon){  // Um ':' só: host:porta
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - target), target);
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+    else{                                           // Sem porta, ou IPv6 literal sem colchetes
+        snprintf(host, sizeof(host), "%s", target);
+        snprintf(port, sizeof(port), "%d", FLEET_PORT);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if(getaddrinfo(host, port, &hints, &res) != 0){
+        return -1;
+    }
+    fleet_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if(fleet_fd >= 0 && connect(fleet_fd, res->ai_addr, res->ai_addrlen) < 0){
+        close(fleet_fd);
+        fleet_fd = -1;
+    }
+    freeaddrinfo(res);
+    return fleet_fd < 0 ? -1 : 0;
+}
+
+// Envia as métricas do ciclo; perdas são toleradas (o agregador conta os buracos)
+static void fleet_push(void){
+    uint8_t packet[FLEET_MAX_PACKET];
+    if(fleet_fd < 0){
+        return;
+    }
+    fleet_values[FLEET_SELF_CPU] = (int64_t)(overhead_cpu_percent() * 1000);
+    size_t len = fleet_encode(&fleet_enc, fleet_node, fleet_values, packet);
+    send(fleet_fd, packet, len, MSG_DONTWAIT);
+}
+
 // GERAÇÃO DO TEXTO
 void generate_text_file(){
     
@@ -230,19 +864,32 @@ void generate_text_file(){
     char device_info[1024];
     char network_devices[1024];
     char process_list[2048];
+    char pressure_info[1024];
+    char cgroup_info[4096];
 
-    get_system_version(version, sizeof(version));
-    get_uptime_and_idle_time(uptime, idle_time, sizeof(uptime));
-    get_datetime(datetime, sizeof(datetime));
-    get_cpu_info(cpu_model, sizeof(cpu_model), &cpu_cores, cpu_speed, sizeof(cpu_speed));
-    get_load_average(load_avg, sizeof(load_avg));
-    get_cpu_usage(cpu_usage, sizeof(cpu_usage));
-    get_memory_info(memory_info, sizeof(memory_info));
-    get_io_info(io_info, sizeof(io_info));
-    get_filesystems(filesystems, sizeof(filesystems));
-    get_device_info(device_info, sizeof(device_info));
-    get_network_devices(network_devices, sizeof(network_devices));
-    get_process_list(process_list, sizeof(process_list));
+    unsigned long long cycle_start = monotonic_ns();
+    unsigned long long cpu_before = self_cpu_us(NULL);
+    unsigned long long syscalls_before = self_syscalls();
+
+    TIMED(COL_SNAPSHOT, get_sysinfo_snapshot());
+    TIMED(COL_VERSION, get_system_version(version, sizeof(version)));
+    TIMED(COL_UPTIME, get_uptime_and_idle_time(uptime, idle_time, sizeof(uptime)));
+    TIMED(COL_DATETIME, get_datetime(datetime, sizeof(datetime)));
+    TIMED(COL_CPU_INFO, get_cpu_info(cpu_model, sizeof(cpu_model), &cpu_cores, cpu_speed, sizeof(cpu_speed)));
+    TIMED(COL_LOAD_AVG, get_load_average(load_avg, sizeof(load_avg)));
+    TIMED(COL_CPU_USAGE, get_cpu_usage(cpu_usage, sizeof(cpu_usage)));
+    TIMED(COL_MEMORY, get_memory_info(memory_info, sizeof(memory_info)));
+    TIMED(COL_IO, get_io_info(io_info, sizeof(io_info)));
+    TIMED(COL_FILESYSTEMS, get_filesystems(filesystems, sizeof(filesystems)));
+    TIMED(COL_DEVICES, get_device_info(device_info, sizeof(device_info)));
+    TIMED(COL_NETWORK, get_network_devices(network_devices, sizeof(network_devices)));
+    TIMED(COL_PROCESSES, get_process_list(process_list, sizeof(process_list)));
+    TIMED(COL_PRESSURE, get_pressure_info(pressure_info, sizeof(pressure_info)));
+    TIMED(COL_CGROUPS, get_cgroup_info(cgroup_info, sizeof(cgroup_info)));
+
+    unsigned long long output_start = monotonic_ns();
+    char overhead_report[4096];
+    format_overhead_report(overhead_report, sizeof(overhead_report));
 
     FILE *html_file = fopen("index.html", "w");
     if(html_file){
@@ -253,6 +900,7 @@ void generate_text_file(){
         fprintf(html_file, "<h1>Trabalho Prático 1 de Construção de Sistemas Operacionais</h1>\n");
         fprintf(html_file, "<h2>Guilherme Specht</h2>\n");
         fprintf(html_file, "<hr>\n");
+        fprintf(html_file, "<p><strong>Fonte das métricas:</strong> %s</p>\n", snapshot_valid ? SYSINFO_DEVICE " (snapshot binário)" : "/proc");
         fprintf(html_file, "<p><strong>Versão do Sistema e Kernel:</strong> %s</p>\n", version);
         fprintf(html_file, "<p><strong>Uptime:</strong> %s</p>\n", uptime);
         fprintf(html_file, "<p><strong>Tempo Ocioso:</strong> %s</p>\n", idle_time);
@@ -264,10 +912,13 @@ void generate_text_file(){
         fprintf(html_file, "<p><strong>Capacidade ocupada do processador:</strong> %s</p>\n", cpu_usage);
         fprintf(html_file, "<p><strong>Memória:</strong> %s</p>\n", memory_info);
         fprintf(html_file, "<p><strong>Operações sobre o sistema de I/O:</strong> %s</p>\n", io_info);
+        fprintf(html_file, "<p><strong>Pressure Stall Information (CPU, memória e I/O):</strong></p>\n<pre>%s</pre>\n", pressure_info);
+        fprintf(html_file, "<p><strong>Recursos por cgroup:</strong></p>\n<pre>%s</pre>\n", cgroup_info);
         fprintf(html_file, "<p><strong>Sistemas de Arquivos Suportados pelo Kernel:</strong></p>\n<pre>%s</pre>\n", filesystems);
         fprintf(html_file, "<p><strong>Dispositivos de Caractere e Bloco e Grupos:</strong></p>\n<pre>%s</pre>\n", device_info);
         fprintf(html_file, "<p><strong>Dispositivos de Rede:</strong></p>\n<pre>%s</pre>\n", network_devices);
         fprintf(html_file, "<p><strong>Lista de Processos:</strong></p>\n<pre>%s</pre>\n", process_list);
+        fprintf(html_file, "<p><strong>Custo do próprio monitor por coletor:</strong></p>\n<pre>%s</pre>\n", overhead_report);
         fprintf(html_file, "</body>\n");
         fprintf(html_file, "</html>\n");
         fclose(html_file);
@@ -275,13 +926,68 @@ void generate_text_file(){
     else{
         perror("ERRO AO ABRIR O ARQUIVO!");
     }
+    write_api_file();
+    fleet_push();
+    window_record(&collector_stats[COL_OUTPUT], monotonic_ns() - output_start);
+
+    window_record(&collector_stats[COL_CYCLE], monotonic_ns() - cycle_start);
+    overhead_record_cycle(cpu_before, syscalls_before);
 }
 
-int main(){
+int main(int argc, char *argv[]){
+    long bench_cycles = 0;
+    int interval = 5;
+    const char *push_target = NULL;
+
+    gethostname(fleet_node, sizeof(fleet_node) - 1);
+
+    // Uso: hello [--cgroup <caminho>]... [--bench N] [--push host[:porta]] [--node nome] [--interval s]
+    //      (IPv6 literal em --push: [addr]:porta)
+    // (caminhos de cgroup relativos a /sys/fs/cgroup)
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--cgroup") == 0 && i + 1 < argc){
+            if(add_cgroup(argv[++i]) < 0){
+                fprintf(stderr, "Limite de %d cgroups atingido, ignorando %s\n", MAX_CGROUPS, argv[i]);
+            }
+        }
+        else if(strcmp(argv[i], "--bench") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0){
+            bench_cycles = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--push") == 0 && i + 1 < argc){
+            push_target = argv[++i];
+        }
+        else if(strcmp(argv[i], "--node") == 0 && i + 1 < argc){
+            snprintf(fleet_node, sizeof(fleet_node), "%s", argv[++i]);
+        }
+        else if(strcmp(argv[i], "--interval") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0){
+            interval = atoi(argv[++i]);
+        }
+        else{
+            fprintf(stderr, "Uso: %s [--cgroup <caminho>]... [--bench N] [--push host[:porta]] [--node nome] [--interval s]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(push_target && fleet_connect(push_target) < 0){
+        fprintf(stderr, "Agregador %s inválido, envio desabilitado\n", push_target);
+    }
+    if(cgroup_count == 0){
+        add_cgroup("");  // Por padrão monitora o cgroup raiz
+    }
+
+    // --bench N: executa N ciclos seguidos, sem dormir, e imprime o relatório de custo
+    if(bench_cycles > 0){
+        char report[4096];
+        for(long i = 0; i < bench_cycles; i++){
+            generate_text_file();
+        }
+        format_overhead_report(report, sizeof(report));
+        printf("%s", report);
+        return 0;
+    }
+
     while(1){
         generate_text_file();
-        sleep(5);
+        sleep(interval);
     }
     return 0;
 }
-
@@ -16,6 +16,7 @@
 #define PORT	8080	//The port on which to listen for incoming data
 
 char http_ok[] = "HTTP/1.0 200 OK\r\nContent-type: text/html\r\nServer: Test\r\n\r\n";
+char http_ok_json[] = "HTTP/1.0 200 OK\r\nContent-type: application/json\r\nServer: Test\r\n\r\n";
 char http_error[] = "HTTP/1.0 400 Bad Request\r\nContent-type: text/html\r\nServer: Test\r\n\r\n";
 
 void die(char *s)
@@ -29,7 +30,8 @@ int main(void)
 	struct sockaddr_in si_me, si_other;
 	int s, recv_len, conn, size;
 	socklen_t slen = sizeof(si_other);
-	char buf[BUFLEN], *page;
+	char buf[BUFLEN], *page, *header;
+	const char *path;
 	int pid;
 	FILE *fd;
 
@@ -85,8 +87,17 @@ int main(void)
 			printf("Data: %s\n" , buf);
 		 
 			if (strstr(buf, "GET")) {
-				/* open the html page file */
-				fd = fopen("index.html", "r");
+				/* /api returns the monitor figures as JSON, anything else the html page */
+				if (strstr(buf, "GET /api")) {
+					path = "api.json";
+					header = http_ok_json;
+				} else {
+					path = "index.html";
+					header = http_ok;
+				}
+
+				/* open the requested file */
+				fd = fopen(path, "r");
 				if (!fd) {
 					write(conn, http_error, strlen(http_error));
 				} else {
@@ -104,7 +115,7 @@ int main(void)
 						fread(page, size, 1, fd);
 						
 						/* now reply the client with the contents of the html page... */
-						write(conn, http_ok, strlen(http_ok));
+						write(conn, header, strlen(header));
 						write(conn, page, size);
 					
 						if (flock(fileno(fd), LOCK_UN))
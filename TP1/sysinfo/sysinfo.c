@@ -0,0 +1,280 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/timekeeping.h>
+#include <linux/kernel_stat.h>
+#include <linux/tick.h>
+#include <linux/sched/loadavg.h>
+#include <linux/blkdev.h>
+#include <linux/part_stat.h>
+#include <linux/netdevice.h>
+#include <net/net_namespace.h>
+
+#include "sysinfo.h"
+
+// Definições do nome do dispositivo e da classe
+#define DEVICE_NAME "sysinfo"         // Nome do dispositivo no /dev
+#define CLASS_NAME  "sysinfo_class"   // Nome da classe do dispositivo
+
+// Informações do módulo
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Guilherme Martins Specht");
+MODULE_DESCRIPTION("Snapshot binário do sistema para o monitor do TP1 de CSO.");
+MODULE_VERSION("0.1.0");
+
+// Variáveis globais para o número principal e a classe do dispositivo
+static int majorNumber;                        // Número principal do dispositivo
+static struct class *sysinfoClass = NULL;      // Classe do dispositivo
+static struct device *sysinfoDevice = NULL;    // Dispositivo do kernel
+
+// Parâmetros configuráveis pelo usuário
+static int update_ms = 1000;     // Período de atualização da página mapeada (ms)
+
+module_param(update_ms, int, 0644);
+MODULE_PARM_DESC(update_ms, "Período de atualização do snapshot mapeado via mmap (ms)");
+
+// Snapshot compartilhado com o espaço de usuário via mmap (atualizado pelo kernel)
+static struct sysinfo_snapshot *shared_snapshot;
+static struct sysinfo_snapshot *scratch_snapshot;  // Coleta do worker antes da cópia para a página
+static struct delayed_work update_work;
+
+// Tempos de CPU de um núcleo, em nanossegundos
+static void collect_cpu(int cpu, struct sysinfo_cpu *out) {
+    struct kernel_cpustat *kcs = &kcpustat_cpu(cpu);
+    u64 idle_us = get_cpu_idle_time_us(cpu, NULL);      // Inclui o tempo ocioso em nohz
+    u64 iowait_us = get_cpu_iowait_time_us(cpu, NULL);
+
+    out->time[SYSINFO_CPU_USER]    = kcs->cpustat[CPUTIME_USER];
+    out->time[SYSINFO_CPU_NICE]    = kcs->cpustat[CPUTIME_NICE];
+    out->time[SYSINFO_CPU_SYSTEM]  = kcs->cpustat[CPUTIME_SYSTEM];
+    out->time[SYSINFO_CPU_IDLE]    = idle_us == -1ULL ? kcs->cpustat[CPUTIME_IDLE] : idle_us * NSEC_PER_USEC;
+    out->time[SYSINFO_CPU_IOWAIT]  = iowait_us == -1ULL ? kcs->cpustat[CPUTIME_IOWAIT] : iowait_us * NSEC_PER_USEC;
+    out->time[SYSINFO_CPU_IRQ]     = kcs->cpustat[CPUTIME_IRQ];
+    out->time[SYSINFO_CPU_SOFTIRQ] = kcs->cpustat[CPUTIME_SOFTIRQ];
+    out->time[SYSINFO_CPU_STEAL]   = kcs->cpustat[CPUTIME_STEAL];
+}
+
+// Contadores dos discos inteiros registrados na classe "block"
+static void collect_disks(struct sysinfo_snapshot *s) {
+    struct class_dev_iter iter;
+    struct device *dev;
+
+    class_dev_iter_init(&iter, &block_class, NULL, NULL);
+    while ((dev = class_dev_iter_next(&iter)) && s->nr_disks < SYSINFO_MAX_DISKS) {
+        struct block_device *bdev = dev_to_bdev(dev);
+        struct sysinfo_disk *d;
+
+        if (bdev_is_partition(bdev))
+            continue;
+
+        d = &s->disks[s->nr_disks++];
+        strscpy(d->name, dev_name(dev), sizeof(d->name));
+        d->reads         = part_stat_read(bdev, ios[STAT_READ]);
+        d->read_sectors  = part_stat_read(bdev, sectors[STAT_READ]);
+        d->writes        = part_stat_read(bdev, ios[STAT_WRITE]);
+        d->write_sectors = part_stat_read(bdev, sectors[STAT_WRITE]);
+        d->io_ticks_ms   = jiffies_to_msecs(part_stat_read(bdev, io_ticks));
+    }
+    class_dev_iter_exit(&iter);
+}
+
+// Contadores das interfaces de rede do namespace inicial
+static void collect_netdevs(struct sysinfo_snapshot *s) {
+    struct net_device *dev;
+    struct rtnl_link_stats64 stats;
+
+    rcu_read_lock();
+    for_each_netdev_rcu(&init_net, dev) {
+        struct sysinfo_netdev *n;
+
+        if (s->nr_netdevs >= SYSINFO_MAX_NETDEVS)
+            break;
+        dev_get_stats(dev, &stats);
+        n = &s->netdevs[s->nr_netdevs++];
+        strscpy(n->name, dev->name, sizeof(n->name));
+        n->rx_bytes   = stats.rx_bytes;
+        n->rx_packets = stats.rx_packets;
+        n->rx_errors  = stats.rx_errors;
+        n->rx_dropped = stats.rx_dropped;
+        n->tx_bytes   = stats.tx_bytes;
+        n->tx_packets = stats.tx_packets;
+        n->tx_errors  = stats.tx_errors;
+        n->tx_dropped = stats.tx_dropped;
+    }
+    rcu_read_unlock();
+}
+
+// Preenche um snapshot completo
+static void sysinfo_collect(struct sysinfo_snapshot *s) {
+    struct sysinfo mem;
+    int cpu, i;
+
+    memset(s, 0, sizeof(*s));
+    s->magic = SYSINFO_MAGIC;
+    s->version = SYSINFO_VERSION;
+    s->size = sizeof(*s);
+    s->timestamp_ns = ktime_get_ns();
+    s->uptime_ns = ktime_to_ns(ktime_get_boottime());
+
+    // Carga: avenrun está em ponto fixo com FSHIFT bits de fração
+    for (i = 0; i < 3; i++) {
+        s->load[i] = ((avenrun[i] + FIXED_1 / 200) * SYSINFO_LOAD_SCALE) >> FSHIFT;
+    }
+
+    // CPUs: totais somados e os primeiros SYSINFO_MAX_CPUS núcleos individualmente
+    for_each_possible_cpu(cpu) {
+        struct sysinfo_cpu c;
+        int f;
+
+        collect_cpu(cpu, &c);
+        for (f = 0; f < SYSINFO_CPU_FIELDS; f++) {
+            s->cpu_total.time[f] += c.time[f];
+        }
+        if (cpu_online(cpu) && s->nr_cpus < SYSINFO_MAX_CPUS) {
+            s->cpus[s->nr_cpus++] = c;
+        }
+    }
+    s->idle_ns = s->cpu_total.time[SYSINFO_CPU_IDLE];
+
+    // Memória (valores do kernel em páginas)
+    si_meminfo(&mem);
+    s->mem_total_kb     = (u64)mem.totalram * mem.mem_unit / 1024;
+    s->mem_free_kb      = (u64)mem.freeram * mem.mem_unit / 1024;
+    s->mem_buffers_kb   = (u64)mem.bufferram * mem.mem_unit / 1024;
+    s->mem_shared_kb    = (u64)mem.sharedram * mem.mem_unit / 1024;
+    s->mem_available_kb = (u64)si_mem_available() << (PAGE_SHIFT - 10);
+
+    collect_disks(s);
+    collect_netdevs(s);
+}
+
+// Atualização periódica da página mapeada, no padrão seqcount
+static void sysinfo_update(struct work_struct *work) {
+    sysinfo_collect(scratch_snapshot);
+
+    shared_snapshot->seq++;          // Ímpar: leitores devem tentar de novo
+    smp_wmb();
+    scratch_snapshot->seq = shared_snapshot->seq;
+    memcpy(shared_snapshot, scratch_snapshot, sizeof(*shared_snapshot));
+    smp_wmb();
+    shared_snapshot->seq++;          // Par: snapshot consistente
+
+    schedule_delayed_work(&update_work, msecs_to_jiffies(update_ms > 0 ? update_ms : 1000));
+}
+
+// Função de leitura do dispositivo: um read na posição 0 devolve um snapshot novo
+// inteiro; depois dele o arquivo está no fim (EOF). pread(fd, ..., 0) lê de novo.
+static ssize_t dev_read(struct file *filep, char __user *buffer, size_t len, loff_t *offset) {
+    struct sysinfo_snapshot *s;
+    ssize_t ret = sizeof(*s);
+
+    if (*offset >= sizeof(*s)) {
+        return 0;                    // Snapshot já entregue: fim do arquivo (cat termina)
+    }
+    if (*offset != 0 || len < sizeof(*s)) {  // O snapshot nunca é entregue pela metade
+        return -EINVAL;
+    }
+
+    s = kzalloc(sizeof(*s), GFP_KERNEL);
+    if (!s) {
+        return -ENOMEM;
+    }
+
+    sysinfo_collect(s);
+    if (copy_to_user(buffer, s, sizeof(*s))) {
+        ret = -EFAULT;
+    } else {
+        *offset += sizeof(*s);
+    }
+
+    kfree(s);
+    return ret;
+}
+
+// Mapeia o snapshot atualizado periodicamente (somente leitura)
+static int dev_mmap(struct file *filep, struct vm_area_struct *vma) {
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_ALIGN(sizeof(*shared_snapshot))) {
+        return -EINVAL;
+    }
+    if (vma->vm_flags & VM_WRITE) {
+        return -EPERM;
+    }
+    vm_flags_clear(vma, VM_MAYWRITE);  // O snapshot é um só para todos: mprotect(PROT_WRITE) também é recusado
+    return remap_vmalloc_range(vma, shared_snapshot, 0);
+}
+
+// Estrutura de operações de arquivo (read, mmap)
+static struct file_operations fops = {
+    .owner = THIS_MODULE,
+    .read = dev_read,
+    .mmap = dev_mmap,
+};
+
+// Função de inicialização do módulo
+static int __init sysinfo_init(void) {
+    shared_snapshot = vmalloc_user(PAGE_ALIGN(sizeof(*shared_snapshot)));  // Zerada e mapeável
+    scratch_snapshot = kzalloc(sizeof(*scratch_snapshot), GFP_KERNEL);
+    if (!shared_snapshot || !scratch_snapshot) {
+        vfree(shared_snapshot);
+        kfree(scratch_snapshot);
+        printk(KERN_ALERT "Sysinfo Driver: failed to allocate the snapshot\n");
+        return -ENOMEM;
+    }
+
+    majorNumber = register_chrdev(0, DEVICE_NAME, &fops);  // Registra o dispositivo e obtém o número major
+    if (majorNumber < 0) {
+        printk(KERN_ALERT "Sysinfo Driver failed to register a major number\n");
+        vfree(shared_snapshot);
+        kfree(scratch_snapshot);
+        return majorNumber;
+    }
+
+    sysinfoClass = class_create(CLASS_NAME);  // Cria a classe do dispositivo
+    if (IS_ERR(sysinfoClass)) {
+        unregister_chrdev(majorNumber, DEVICE_NAME);
+        vfree(shared_snapshot);
+        kfree(scratch_snapshot);
+        printk(KERN_ALERT "Failed to register device class\n");
+        return PTR_ERR(sysinfoClass);
+    }
+
+    sysinfoDevice = device_create(sysinfoClass, NULL, MKDEV(majorNumber, 0), NULL, DEVICE_NAME);  // Cria o dispositivo
+    if (IS_ERR(sysinfoDevice)) {
+        class_destroy(sysinfoClass);
+        unregister_chrdev(majorNumber, DEVICE_NAME);
+        vfree(shared_snapshot);
+        kfree(scratch_snapshot);
+        printk(KERN_ALERT "Failed to create the device\n");
+        return PTR_ERR(sysinfoDevice);
+    }
+
+    // Primeira atualização imediata; as próximas a cada update_ms
+    INIT_DELAYED_WORK(&update_work, sysinfo_update);
+    schedule_delayed_work(&update_work, 0);
+
+    printk(KERN_INFO "Sysinfo Driver: initialized with major number %d (snapshot de %zu bytes)\n",
+           majorNumber, sizeof(*shared_snapshot));
+    return 0;
+}
+
+// Função de saída do módulo
+static void __exit sysinfo_exit(void) {
+    cancel_delayed_work_sync(&update_work);
+    device_destroy(sysinfoClass, MKDEV(majorNumber, 0));  // Destrói o dispositivo
+    class_destroy(sysinfoClass);                          // Destroi a classe
+    unregister_chrdev(majorNumber, DEVICE_NAME);          // Remove o registro do dispositivo
+    vfree(shared_snapshot);
+    kfree(scratch_snapshot);
+    printk(KERN_INFO "Sysinfo Driver: exiting\n");
+}
+
+// Define as funções de inicialização e saída do módulo
+module_init(sysinfo_init);
+module_exit(sysinfo_exit);
@@ -0,0 +1,94 @@
+/*
+ * Layout binário do /dev/sysinfo, compartilhado entre o módulo (sysinfo.c)
+ * e o monitor em espaço de usuário (TP1/apps/hello.c).
+ *
+ * Um read() na posição 0 devolve uma struct sysinfo_snapshot completa, e o
+ * seguinte devolve fim de arquivo; pread(fd, ..., 0) pega um snapshot novo
+ * sem reabrir. O mapeamento é só de leitura. O mesmo layout
+ * fica disponível via mmap() em SYSINFO_MMAP_SIZE bytes, atualizado pelo
+ * kernel a cada update_ms; nesse caso o campo seq é ímpar durante a
+ * atualização e o leitor deve repetir a cópia até ler o mesmo seq par
+ * antes e depois.
+ *
+ * Qualquer mudança no layout deve incrementar SYSINFO_VERSION.
+ */
+#ifndef SYSINFO_H
+#define SYSINFO_H
+
+#include <linux/types.h>
+
+#define SYSINFO_DEVICE      "/dev/sysinfo"
+#define SYSINFO_MAGIC       0x49535953  // "SYSI"
+#define SYSINFO_VERSION     1
+
+#define SYSINFO_MAX_CPUS    32
+#define SYSINFO_MAX_DISKS   16
+#define SYSINFO_MAX_NETDEVS 16
+#define SYSINFO_NAME_LEN    32
+
+// Carga do sistema em ponto fixo: valor real = load / SYSINFO_LOAD_SCALE
+#define SYSINFO_LOAD_SCALE  100
+
+// Campos de tempo de CPU, na mesma ordem de /proc/stat (nanossegundos)
+enum sysinfo_cpu_field {
+    SYSINFO_CPU_USER,
+    SYSINFO_CPU_NICE,
+    SYSINFO_CPU_SYSTEM,
+    SYSINFO_CPU_IDLE,
+    SYSINFO_CPU_IOWAIT,
+    SYSINFO_CPU_IRQ,
+    SYSINFO_CPU_SOFTIRQ,
+    SYSINFO_CPU_STEAL,
+    SYSINFO_CPU_FIELDS
+};
+
+struct sysinfo_cpu {
+    __u64 time[SYSINFO_CPU_FIELDS];
+};
+
+// Contadores de um disco inteiro (partições não são incluídas)
+struct sysinfo_disk {
+    char  name[SYSINFO_NAME_LEN];
+    __u64 reads;                // Leituras completadas
+    __u64 read_sectors;
+    __u64 writes;               // Escritas completadas
+    __u64 write_sectors;
+    __u64 io_ticks_ms;          // Tempo com I/O em andamento
+};
+
+struct sysinfo_netdev {
+    char  name[SYSINFO_NAME_LEN];
+    __u64 rx_bytes, rx_packets, rx_errors, rx_dropped;
+    __u64 tx_bytes, tx_packets, tx_errors, tx_dropped;
+};
+
+struct sysinfo_snapshot {
+    __u32 magic;                // SYSINFO_MAGIC
+    __u32 version;              // SYSINFO_VERSION
+    __u32 size;                 // sizeof(struct sysinfo_snapshot)
+    __u32 seq;                  // Contador de atualizações (ímpar = em atualização, só no mmap)
+    __u64 timestamp_ns;         // CLOCK_MONOTONIC da coleta
+    __u64 uptime_ns;            // Tempo desde o boot (inclui suspensão)
+    __u64 idle_ns;              // Tempo ocioso somado de todas as CPUs
+
+    __u32 load[3];              // Carga de 1, 5 e 15 minutos (x SYSINFO_LOAD_SCALE)
+    __u32 nr_cpus;              // Entradas válidas em cpus[]
+    __u32 nr_disks;             // Entradas válidas em disks[]
+    __u32 nr_netdevs;           // Entradas válidas em netdevs[]
+
+    __u64 mem_total_kb;
+    __u64 mem_free_kb;
+    __u64 mem_available_kb;
+    __u64 mem_buffers_kb;
+    __u64 mem_shared_kb;
+
+    struct sysinfo_cpu    cpu_total;
+    struct sysinfo_cpu    cpus[SYSINFO_MAX_CPUS];
+    struct sysinfo_disk   disks[SYSINFO_MAX_DISKS];
+    struct sysinfo_netdev netdevs[SYSINFO_MAX_NETDEVS];
+};
+
+// Região mapeável: a struct arredondada para páginas inteiras
+#define SYSINFO_MMAP_SIZE   ((sizeof(struct sysinfo_snapshot) + 4095) & ~4095UL)
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Benchmark da busca de processos no mqueue: mede a latência de envio
+ * enquanto o número de processos registrados cresce de 1 a 10000.
+ * Com o registro indexado por hash a latência deve ficar constante.
+ * Cada endpoint precisa de um arquivo aberto próprio (um /reg por arquivo).
+ *
+ * Uso: bench_lookup [envios por ponto]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define BUFFER_LENGTH 64
+#define MAX_ENDPOINTS 10000
+
+static const int points[] = {1, 10, 100, 1000, 10000};
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Envia um comando de texto ao driver
+static int command(int fd, const char *fmt, int n) {
+    char buf[BUFFER_LENGTH];
+    int len = snprintf(buf, sizeof(buf), fmt, n);
+    return write(fd, buf, len) < 0 ? -errno : 0;
+}
+
+static int endpoint_fds[MAX_ENDPOINTS];
+
+int main(int argc, char *argv[]) {
+    int sends = argc > 1 ? atoi(argv[1]) : 20000;  // Envios medidos em cada ponto
+    struct rlimit rl = { MAX_ENDPOINTS + 64, MAX_ENDPOINTS + 64 };
+    int registered = 0, fd, i, p, ret = 0;
+
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0) {  // Um descritor por endpoint
+        perror("setrlimit");
+    }
+
+    fd = open("/dev/mqueue0", O_RDWR);  // Só envia: não registra nada
+    if (fd < 0) {
+        perror("Failed to open the device...");
+        return errno;
+    }
+
+    printf("%12s %14s %14s\n", "registrados", "ns/envio", "envios/s");
+    for (p = 0; p < (int)(sizeof(points) / sizeof(points[0])); p++) {
+        long long start, elapsed;
+
+        // Registra endpoints até chegar no ponto atual
+        while (registered < points[p]) {
+            int efd = open("/dev/mqueue0", O_RDWR);
+
+            if (efd < 0) {
+                ret = -errno;
+                fprintf(stderr, "Falha ao abrir o dispositivo: %s\n", strerror(errno));
+                goto out;
+            }
+            endpoint_fds[registered] = efd;
+            if ((ret = command(efd, "/reg bench%05d", registered)) < 0) {
+                fprintf(stderr, "Falha ao registrar bench%05d: %s\n", registered, strerror(-ret));
+                close(efd);
+                goto out;
+            }
+            registered++;
+        }
+
+        // Envia para destinos espalhados por todo o registro
+        start = now_ns();
+        for (i = 0; i < sends; i++) {
+            if ((ret = command(fd, "/bench%05d m", (int)((i * 7919L) % registered))) < 0) {
+                fprintf(stderr, "Falha no envio: %s\n", strerror(-ret));
+                goto out;
+            }
+        }
+        elapsed = now_ns() - start;
+        printf("%12d %14.0f %14.0f\n", registered, (double)elapsed / sends, sends * 1e9 / elapsed);
+    }
+    ret = 0;
+
+out:
+    // Fechar o arquivo desregistra o endpoint e descarta as mensagens que ficaram na fila
+    for (i = 0; i < registered; i++) {
+        close(endpoint_fds[i]);
+    }
+    close(fd);
+    return ret < 0 ? 1 : 0;
+}
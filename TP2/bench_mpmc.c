@@ -0,0 +1,465 @@
+/*
+ * Benchmark de vazão e latência do mqueue com vários produtores e consumidores.
+ * Cada consumidor é uma thread com o seu arquivo e o seu processo registrado;
+ * cada produtor é uma thread que envia lotes (SEND_BATCH) aos consumidores em
+ * rodízio. A mensagem leva o instante do envio, e o consumidor mede a latência
+ * de ponta a ponta ao retirá-la (RECV_BATCH).
+ *
+ * Listas separadas por vírgula em -p, -c e -s rodam todas as combinações, uma
+ * linha de resultado por combinação. Com -j a saída é uma linha JSON por
+ * combinação, para comparar execuções entre versões do driver.
+ *
+ * Uso: bench_mpmc [-p produtores] [-c consumidores] [-s bytes] [-d segundos |
+ *                 -n mensagens por produtor] [-b lote] [-a] [-N] [-j] [-D dispositivo]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+#include "mqueue.h"
+
+#define MAX_THREADS   256
+#define MAX_LIST      16
+#define MAX_SAMPLES   (1 << 20)    // Amostras de latência guardadas por consumidor
+#define MSG_MAX       32768
+
+// Cabeçalho no início de cada mensagem; o resto é enchimento
+struct stamp {
+    uint64_t sent_ns;              // CLOCK_MONOTONIC no envio
+    uint32_t producer;
+    uint32_t seq;
+};
+
+struct config {
+    int producers, consumers, size;
+    int duration;                  // Segundos (modo duração) ou 0
+    long count;                    // Mensagens por produtor (modo contagem) ou 0
+    int batch;
+    int pin, nonblock, json;
+    const char *device;
+};
+
+struct producer {
+    pthread_t thread;
+    const struct config *cfg;
+    int id, cpu, fd;
+    const int *handles;            // Handles dos consumidores
+    long sent, rejected, failed;
+};
+
+struct consumer {
+    pthread_t thread;
+    const struct config *cfg;
+    int id, cpu, fd;
+    long received, bytes, corrupt;
+    uint64_t *samples;
+    long nsamples, seen;           // seen = latências observadas (amostragem de reservatório além de MAX_SAMPLES)
+    uint64_t rng;
+};
+
+static volatile int stop_producers;     // Modo duração: o tempo acabou
+static volatile int producers_done;     // Consumidores drenam o que sobrou e saem
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pin(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        return;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        fprintf(stderr, "Falha ao fixar a thread na CPU %d\n", cpu);
+    }
+}
+
+static void *producer_main(void *arg) {
+    struct producer *p = arg;
+    const struct config *cfg = p->cfg;
+    struct mqueue_msg msgs[MQUEUE_BATCH_MAX];
+    char *bufs = calloc(cfg->batch, cfg->size);
+    struct mqueue_batch batch;
+    uint32_t seq = 0;
+    int next = p->id % cfg->consumers;  // Produtores começam em consumidores diferentes
+    int i;
+
+    if (!bufs) {
+        return NULL;
+    }
+    pin(p->cpu);
+
+    while (!stop_producers && (!cfg->count || p->sent + p->rejected + p->failed < cfg->count)) {
+        int n = cfg->batch;
+
+        if (cfg->count && cfg->count - (p->sent + p->rejected + p->failed) < n) {
+            n = cfg->count - (p->sent + p->rejected + p->failed);
+        }
+        for (i = 0; i < n; i++) {
+            struct stamp *st = (struct stamp *)(bufs + (size_t)i * cfg->size);
+
+            st->producer = p->id;
+            st->seq = seq++;
+            st->sent_ns = now_ns();
+            msgs[i].data = (uintptr_t)st;
+            msgs[i].len = cfg->size;
+            msgs[i].handle = p->handles[next];
+            msgs[i].priority = 0;
+            next = (next + 1) % cfg->consumers;
+        }
+
+        batch.msgs = (uintptr_t)msgs;
+        batch.count = n;
+        batch.done = 0;
+        batch.handle = 0;
+        if (ioctl(p->fd, MQUEUE_IOC_SEND_BATCH, &batch) < 0 && batch.done == 0) {
+            fprintf(stderr, "SEND_BATCH: %s\n", strerror(errno));
+            break;
+        }
+        for (i = 0; i < (int)batch.done; i++) {
+            if (msgs[i].status == 0) {
+                p->sent++;
+            } else if (msgs[i].status == -EAGAIN || msgs[i].status == -ENOBUFS) {
+                p->rejected++;           // Fila cheia com REJECT, DROP_NEW ou O_NONBLOCK
+            } else {
+                p->failed++;
+            }
+        }
+        if (batch.done && msgs[batch.done - 1].status == -EAGAIN) {
+            sched_yield();               // Dá tempo aos consumidores
+        }
+    }
+
+    free(bufs);
+    return NULL;
+}
+
+static void record_latency(struct consumer *c, uint64_t lat) {
+    if (c->nsamples < MAX_SAMPLES) {
+        c->samples[c->nsamples++] = lat;
+    } else {
+        uint64_t r;
+
+        c->rng ^= c->rng << 13;          // xorshift64
+        c->rng ^= c->rng >> 7;
+        c->rng ^= c->rng << 17;
+        r = c->rng % (uint64_t)(c->seen + 1);
+        if (r < MAX_SAMPLES) {
+            c->samples[r] = lat;
+        }
+    }
+    c->seen++;
+}
+
+static void *consumer_main(void *arg) {
+    struct consumer *c = arg;
+    const struct config *cfg = c->cfg;
+    struct mqueue_msg msgs[MQUEUE_BATCH_MAX];
+    char *bufs = malloc((size_t)cfg->batch * cfg->size);
+    struct pollfd pfd = { c->fd, POLLIN, 0 };
+    struct mqueue_batch batch;
+    int i;
+
+    if (!bufs) {
+        return NULL;
+    }
+    pin(c->cpu);
+
+    for (;;) {
+        uint64_t t;
+
+        for (i = 0; i < cfg->batch; i++) {
+            msgs[i].data = (uintptr_t)(bufs + (size_t)i * cfg->size);
+            msgs[i].len = cfg->size;
+        }
+        batch.msgs = (uintptr_t)msgs;
+        batch.count = cfg->batch;
+        batch.done = 0;
+        batch.handle = 0;                // A fila deste arquivo
+        if (ioctl(c->fd, MQUEUE_IOC_RECV_BATCH, &batch) < 0 && batch.done == 0) {
+            if (errno != EAGAIN) {
+                fprintf(stderr, "RECV_BATCH: %s\n", strerror(errno));
+                break;
+            }
+            if (producers_done) {        // Fila vazia depois do último envio
+                break;
+            }
+            poll(&pfd, 1, 10);           // Timeout curto para notar o fim dos produtores
+            continue;
+        }
+
+        t = now_ns();
+        for (i = 0; i < (int)batch.done; i++) {
+            const struct stamp *st = (const struct stamp *)(bufs + (size_t)i * cfg->size);
+
+            if (msgs[i].status != 0 || msgs[i].len != (uint32_t)cfg->size) {
+                c->corrupt++;
+                continue;
+            }
+            c->received++;
+            c->bytes += msgs[i].len;
+            record_latency(c, t - st->sent_ns);
+        }
+    }
+
+    free(bufs);
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *v, long n, double p) {
+    long i;
+
+    if (n == 0) {
+        return 0;
+    }
+    i = (long)(p * (n - 1) + 0.5);
+    return v[i];
+}
+
+// Uma combinação de produtores, consumidores e tamanho
+static int run(const struct config *cfg) {
+    static struct producer prod[MAX_THREADS];
+    static struct consumer cons[MAX_THREADS];
+    static int handles[MAX_THREADS];
+    long sent = 0, rejected = 0, failed = 0, received = 0, bytes = 0, corrupt = 0, nsamples = 0;
+    int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t *all, start, elapsed;
+    double secs;
+    int i, ret = -1;
+
+    memset(prod, 0, sizeof(prod));
+    memset(cons, 0, sizeof(cons));
+    stop_producers = 0;
+    producers_done = 0;
+    for (i = 0; i < MAX_THREADS; i++) {
+        prod[i].fd = cons[i].fd = -1;
+    }
+
+    // Consumidores: um arquivo e um /reg cada
+    for (i = 0; i < cfg->consumers; i++) {
+        struct mqueue_reg reg;
+
+        cons[i].samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+        if (!cons[i].samples) {
+            fprintf(stderr, "Sem memória para as amostras\n");
+            goto out;
+        }
+        cons[i].fd = open(cfg->device, O_RDWR);
+        if (cons[i].fd < 0) {
+            perror("Failed to open the device...");
+            goto out;
+        }
+        memset(&reg, 0, sizeof(reg));
+        snprintf(reg.name, sizeof(reg.name), "mpmc%d-%d", (int)getpid(), i);
+        if (ioctl(cons[i].fd, MQUEUE_IOC_REGISTER, &reg) < 0) {
+            fprintf(stderr, "Falha ao registrar %s: %s\n", reg.name, strerror(errno));
+            goto out;
+        }
+        handles[i] = reg.handle;
+        cons[i].cfg = cfg;
+        cons[i].id = i;
+        cons[i].cpu = cfg->pin ? (cfg->producers + i) % ncpu : -1;
+        cons[i].rng = 0x9e3779b97f4a7c15ULL ^ (uint64_t)(i + 1);
+    }
+
+    // Produtores: só enviam, sem registro
+    for (i = 0; i < cfg->producers; i++) {
+        prod[i].fd = open(cfg->device, O_RDWR | (cfg->nonblock ? O_NONBLOCK : 0));
+        if (prod[i].fd < 0) {
+            perror("Failed to open the device...");
+            goto out;
+        }
+        prod[i].cfg = cfg;
+        prod[i].id = i;
+        prod[i].cpu = cfg->pin ? i % ncpu : -1;
+        prod[i].handles = handles;
+    }
+
+    start = now_ns();
+    for (i = 0; i < cfg->consumers; i++) {
+        pthread_create(&cons[i].thread, NULL, consumer_main, &cons[i]);
+    }
+    for (i = 0; i < cfg->producers; i++) {
+        pthread_create(&prod[i].thread, NULL, producer_main, &prod[i]);
+    }
+
+    if (cfg->duration) {
+        sleep(cfg->duration);
+        stop_producers = 1;
+    }
+    for (i = 0; i < cfg->producers; i++) {
+        pthread_join(prod[i].thread, NULL);
+        sent += prod[i].sent;
+        rejected += prod[i].rejected;
+        failed += prod[i].failed;
+    }
+    producers_done = 1;
+    for (i = 0; i < cfg->consumers; i++) {
+        pthread_join(cons[i].thread, NULL);
+        received += cons[i].received;
+        bytes += cons[i].bytes;
+        corrupt += cons[i].corrupt;
+        nsamples += cons[i].nsamples;
+    }
+    elapsed = now_ns() - start;
+    secs = elapsed / 1e9;
+
+    all = malloc((nsamples ? nsamples : 1) * sizeof(uint64_t));
+    if (!all) {
+        fprintf(stderr, "Sem memória para as amostras\n");
+        goto out;
+    }
+    nsamples = 0;
+    for (i = 0; i < cfg->consumers; i++) {
+        memcpy(all + nsamples, cons[i].samples, cons[i].nsamples * sizeof(uint64_t));
+        nsamples += cons[i].nsamples;
+    }
+    qsort(all, nsamples, sizeof(uint64_t), cmp_u64);
+
+    // dropped: aceitas pelo driver e nunca entregues (descartadas pela DROP_OLDEST)
+    if (cfg->json) {
+        printf("{\"producers\":%d,\"consumers\":%d,\"size\":%d,\"batch\":%d,\"mode\":\"%s\","
+               "\"elapsed_s\":%.3f,\"sent\":%ld,\"received\":%ld,\"rejected\":%ld,\"dropped\":%ld,"
+               "\"errors\":%ld,\"msgs_per_s\":%.0f,\"bytes_per_s\":%.0f,"
+               "\"lat_ns\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}\n",
+               cfg->producers, cfg->consumers, cfg->size, cfg->batch, cfg->duration ? "duration" : "count",
+               secs, sent, received, rejected, sent - received, failed + corrupt,
+               received / secs, bytes / secs,
+               (unsigned long long)percentile(all, nsamples, 0.50),
+               (unsigned long long)percentile(all, nsamples, 0.90),
+               (unsigned long long)percentile(all, nsamples, 0.99),
+               (unsigned long long)percentile(all, nsamples, 0.999),
+               (unsigned long long)(nsamples ? all[nsamples - 1] : 0));
+    } else {
+        printf("%4d %4d %6d %8.2f %10ld %10ld %9ld %9ld %12.0f %12.0f %9llu %9llu %9llu %9llu\n",
+               cfg->producers, cfg->consumers, cfg->size, secs, sent, received, rejected,
+               sent - received, received / secs, bytes / secs,
+               (unsigned long long)percentile(all, nsamples, 0.50),
+               (unsigned long long)percentile(all, nsamples, 0.99),
+               (unsigned long long)percentile(all, nsamples, 0.999),
+               (unsigned long long)(nsamples ? all[nsamples - 1] : 0));
+        if (failed + corrupt) {
+            fprintf(stderr, "%ld envios com erro, %ld mensagens inválidas\n", failed, corrupt);
+        }
+    }
+    fflush(stdout);
+    free(all);
+    ret = 0;
+
+out:
+    // Fechar os arquivos desregistra os consumidores
+    for (i = 0; i < cfg->producers; i++) {
+        if (prod[i].fd >= 0) {
+            close(prod[i].fd);
+        }
+    }
+    for (i = 0; i < cfg->consumers; i++) {
+        if (cons[i].fd >= 0) {
+            close(cons[i].fd);
+        }
+        free(cons[i].samples);
+    }
+    return ret;
+}
+
+// "1,2,4" -> {1, 2, 4}
+static int parse_list(const char *s, int *out) {
+    int n = 0;
+
+    while (*s && n < MAX_LIST) {
+        char *end;
+
+        out[n++] = strtol(s, &end, 10);
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+        s = *end ? end + 1 : end;
+    }
+    return n;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [-p produtores] [-c consumidores] [-s bytes] [-d segundos | -n mensagens]\n"
+            "          [-b lote] [-a] [-N] [-j] [-D dispositivo]\n"
+            "  -p, -c, -s aceitam listas (1,2,4) e rodam todas as combinações\n"
+            "  -d  duração fixa (padrão 5 s); -n  mensagens por produtor\n"
+            "  -b  mensagens por SEND/RECV_BATCH (1..%d, padrão 16)\n"
+            "  -a  fixa cada thread numa CPU; -N  produtores com O_NONBLOCK\n"
+            "  -j  uma linha JSON por combinação\n", prog, MQUEUE_BATCH_MAX);
+}
+
+int main(int argc, char *argv[]) {
+    int plist[MAX_LIST] = {1}, clist[MAX_LIST] = {1}, slist[MAX_LIST] = {64};
+    int np = 1, nc = 1, ns = 1, ip, ic, is, opt;
+    struct config cfg = { .duration = 5, .batch = 16, .device = MQUEUE_DEVICE };
+
+    while ((opt = getopt(argc, argv, "p:c:s:d:n:b:aNjD:h")) != -1) {
+        switch (opt) {
+        case 'p': np = parse_list(optarg, plist); break;
+        case 'c': nc = parse_list(optarg, clist); break;
+        case 's': ns = parse_list(optarg, slist); break;
+        case 'd': cfg.duration = atoi(optarg); cfg.count = 0; break;
+        case 'n': cfg.count = atol(optarg); cfg.duration = 0; break;
+        case 'b': cfg.batch = atoi(optarg); break;
+        case 'a': cfg.pin = 1; break;
+        case 'N': cfg.nonblock = 1; break;
+        case 'j': cfg.json = 1; break;
+        case 'D': cfg.device = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (np <= 0 || nc <= 0 || ns <= 0 || cfg.batch < 1 || cfg.batch > MQUEUE_BATCH_MAX ||
+        (cfg.duration <= 0 && cfg.count <= 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!cfg.json) {
+        printf("%4s %4s %6s %8s %10s %10s %9s %9s %12s %12s %9s %9s %9s %9s\n",
+               "prod", "cons", "bytes", "seg", "enviadas", "recebidas", "recusadas", "perdidas",
+               "msgs/s", "bytes/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    }
+    for (ip = 0; ip < np; ip++) {
+        for (ic = 0; ic < nc; ic++) {
+            for (is = 0; is < ns; is++) {
+                cfg.producers = plist[ip];
+                cfg.consumers = clist[ic];
+                cfg.size = slist[is];
+                if (cfg.producers < 1 || cfg.producers > MAX_THREADS ||
+                    cfg.consumers < 1 || cfg.consumers > MAX_THREADS ||
+                    cfg.size < (int)sizeof(struct stamp) || cfg.size > MSG_MAX) {
+                    fprintf(stderr, "Combinação inválida: %d produtores, %d consumidores, %d bytes "
+                            "(mínimo %zu bytes por mensagem)\n",
+                            cfg.producers, cfg.consumers, cfg.size, sizeof(struct stamp));
+                    return 1;
+                }
+                if (run(&cfg) < 0) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
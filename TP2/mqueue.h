@@ -0,0 +1,163 @@
+/*
+ * Layout binário compartilhado entre o driver mqueue (t2.c) e os
+ * consumidores em espaço de usuário.
+ *
+ * Com queue_mode=1 cada processo registrado tem um anel de slots. O arquivo
+ * que fez o /reg pode mapeá-lo com mmap(): a primeira página é o controle
+ * (struct mqueue_ring_ctrl) e os slots começam em data_offset. O kernel é o
+ * único produtor e publica head; o consumidor lê os slots de tail até head e
+ * publica o novo tail, sem syscall. poll() ou read() bloqueante servem só
+ * para esperar mensagens novas.
+ *
+ * Enquanto o anel está mapeado o kernel não descarta mensagens nem bloqueia
+ * escritores: com o anel cheio o envio falha com EAGAIN até o consumidor
+ * avançar o tail (ou ENOBUFS com MQUEUE_OVERFLOW_DROP_NEW).
+ */
+#ifndef MQUEUE_H
+#define MQUEUE_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define MQUEUE_DEVICE       "/dev/mqueue0"   // Primeira instância criada na carga do módulo
+#define MQUEUE_RING_MAGIC   0x474e524d  // "MRNG"
+
+// Página de controle no início do mapeamento
+struct mqueue_ring_ctrl {
+    __u32 magic;                 // MQUEUE_RING_MAGIC
+    __u32 slots;                 // Capacidade do anel: max_messages arredondado para potência de 2
+    __u32 slot_size;             // Bytes por slot
+    __u32 data_offset;           // Deslocamento do primeiro slot no mapeamento
+    // head e tail em linhas de cache separadas: cada lado só escreve a sua
+    __u32 head __attribute__((aligned(64)));  // Próximo slot a escrever (kernel, contador livre)
+    __u32 tail __attribute__((aligned(64)));  // Próxima mensagem a ler (consumidor, contador livre)
+};
+
+// Slot do anel: mensagem pos fica em data_offset + (pos & (slots - 1)) * slot_size
+struct mqueue_ring_slot {
+    __u16 size;                  // Tamanho da mensagem
+    char data[];                 // Conteúdo terminado em '\0'
+};
+
+// read() no arquivo que fez o /reg retira mensagens da sua fila e devolve uma
+// sequência de registros: cabeçalho seguido de len bytes de conteúdo, sem
+// alinhamento. Só mensagens inteiras são entregues; se a próxima não cabe
+// no buffer o read falha com EMSGSIZE.
+struct mqueue_record {
+    __u32 len;                   // Bytes de conteúdo que seguem o cabeçalho
+} __attribute__((packed));
+
+// ---------------------------------------------------------------------------
+// API binária (ioctl). Processos são identificados por handles inteiros
+// devolvidos no registro ou na busca por nome; o protocolo de texto continua
+// disponível para o TP2/test.c.
+
+#define MQUEUE_NAME_LEN     64     // Nome com '\0'
+#define MQUEUE_BATCH_MAX    64     // Descritores por chamada de SEND/RECV_BATCH
+
+// REGISTER: name -> handle. Um processo por arquivo aberto (EBUSY no segundo);
+// fechar o arquivo desregistra o processo.
+// LOOKUP: name -> handle de um processo registrado, para usar como destino
+struct mqueue_reg {
+    char name[MQUEUE_NAME_LEN];
+    __s32 handle;                // Saída
+    __u32 reserved;
+};
+
+// Prioridades de 0 (padrão, menos urgente) a MQUEUE_PRIO_MAX - 1. No modo lista a
+// fila entrega sempre a mensagem mais antiga da prioridade mais alta, e com a fila
+// cheia descarta primeiro as de prioridade mais baixa. O anel (queue_mode=1) é FIFO.
+#define MQUEUE_PRIO_MAX     32
+
+// Uma mensagem de um lote.
+// SEND: handle = destino, data/len = conteúdo, priority = prioridade.
+// RECV: data/len = buffer e capacidade; na volta len = tamanho e priority =
+// prioridade da mensagem.
+// status = 0 ou -errno daquela mensagem.
+struct mqueue_msg {
+    __u64 data;                  // Ponteiro do espaço de usuário
+    __s32 handle;
+    __u32 len;
+    __s32 status;                // Saída
+    __u32 priority;              // Era reserved: zero continua valendo a prioridade padrão
+};
+
+// Lote: count descritores em msgs; done = quantos foram processados.
+// RECV lê do processo handle (0 = o processo deste arquivo; outro handle só
+// se registrado pelo mesmo PID) e não bloqueia: para esperar use poll().
+struct mqueue_batch {
+    __u64 msgs;                  // Ponteiro para struct mqueue_msg[count]
+    __u32 count;
+    __u32 done;                  // Saída
+    __s32 handle;                // Só RECV
+    __u32 reserved;
+};
+
+// Política de fila cheia. A fila está cheia quando chega a max_messages, à cota de
+// bytes do processo ou ao orçamento global de memória do driver (modo lista; no
+// modo anel o anel é a cota e já conta inteiro no orçamento).
+#define MQUEUE_OVERFLOW_DROP_OLDEST 0  // Descarta as mais antigas da prioridade mais baixa (padrão)
+#define MQUEUE_OVERFLOW_DROP_NEW    1  // Descarta a mensagem nova (ENOBUFS)
+#define MQUEUE_OVERFLOW_REJECT      2  // Recusa o envio com EAGAIN, nada se perde
+#define MQUEUE_OVERFLOW_BLOCK       3  // O escritor dorme até haver espaço (REJECT com O_NONBLOCK
+                                       // ou com o anel mapeado)
+
+// SET_LIMITS: política e cota dos envios diretos ao processo deste arquivo.
+// Na volta, dropped e blocked são os descartes e esperas acumulados na fila.
+struct mqueue_limits {
+    __u64 quota_bytes;           // Bytes de conteúdo na fila, 0 = sem limite (modo lista)
+    __u32 policy;                // MQUEUE_OVERFLOW_*
+    __u32 reserved;
+    __u64 dropped;               // Saída
+    __u64 blocked;               // Saída
+};
+
+// Publish/subscribe: um processo registrado assina tópicos; uma publicação é
+// entregue na fila de cada assinante. policy (DROP_OLDEST ou DROP_NEW) diz o que
+// fazer quando a fila daquele assinante está cheia: a publicação nunca bloqueia.
+
+// SUBSCRIBE/UNSUBSCRIBE: para o processo registrado por este arquivo
+struct mqueue_sub {
+    char topic[MQUEUE_NAME_LEN];
+    __u32 policy;                // MQUEUE_OVERFLOW_*
+    __u32 reserved;
+};
+
+// PUBLISH: delivered = quantos assinantes receberam a mensagem
+struct mqueue_pub {
+    char topic[MQUEUE_NAME_LEN];
+    __u64 data;                  // Ponteiro do espaço de usuário
+    __u32 len;
+    __u32 delivered;             // Saída
+};
+
+// Instâncias: cada /dev/mqueueN (nr_instances na carga) ou /dev/mqueue-<nome> tem os
+// seus processos, tópicos, limites e estatísticas; handles e nomes só valem dentro da
+// instância. Os limites de cada uma ficam em /sys/class/mqueue_class/<dispositivo>/.
+// CREATE_INSTANCE cria /dev/mqueue-<nome> (nome com [A-Za-z0-9_-]); limites zero usam
+// os parâmetros do módulo. DESTROY_INSTANCE remove o dispositivo; arquivos abertos
+// continuam valendo até serem fechados. Exigem CAP_SYS_ADMIN.
+struct mqueue_instance {
+    char name[MQUEUE_NAME_LEN];
+    __u32 max_messages;
+    __u32 max_msg_size;
+    __u64 max_total_bytes;
+    __u64 max_queue_bytes;
+    __u32 overflow_policy;       // MQUEUE_OVERFLOW_*
+    __u32 minor;                 // Saída
+};
+
+#define MQUEUE_IOC_MAGIC        'q'
+#define MQUEUE_IOC_REGISTER     _IOWR(MQUEUE_IOC_MAGIC, 1, struct mqueue_reg)
+#define MQUEUE_IOC_UNREGISTER   _IOW(MQUEUE_IOC_MAGIC, 2, __s32)
+#define MQUEUE_IOC_LOOKUP       _IOWR(MQUEUE_IOC_MAGIC, 3, struct mqueue_reg)
+#define MQUEUE_IOC_SEND_BATCH   _IOWR(MQUEUE_IOC_MAGIC, 4, struct mqueue_batch)
+#define MQUEUE_IOC_RECV_BATCH   _IOWR(MQUEUE_IOC_MAGIC, 5, struct mqueue_batch)
+#define MQUEUE_IOC_SUBSCRIBE    _IOW(MQUEUE_IOC_MAGIC, 6, struct mqueue_sub)
+#define MQUEUE_IOC_UNSUBSCRIBE  _IOW(MQUEUE_IOC_MAGIC, 7, struct mqueue_sub)
+#define MQUEUE_IOC_PUBLISH      _IOWR(MQUEUE_IOC_MAGIC, 8, struct mqueue_pub)
+#define MQUEUE_IOC_SET_LIMITS   _IOWR(MQUEUE_IOC_MAGIC, 9, struct mqueue_limits)
+#define MQUEUE_IOC_CREATE_INSTANCE  _IOWR(MQUEUE_IOC_MAGIC, 10, struct mqueue_instance)
+#define MQUEUE_IOC_DESTROY_INSTANCE _IOW(MQUEUE_IOC_MAGIC, 11, struct mqueue_instance)
+
+#endif
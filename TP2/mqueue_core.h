@@ -0,0 +1,113 @@
+/*
+ * Núcleo das filas do mqueue (t2.c), separado do resto do driver: a fila de
+ * prioridades do modo lista e a aritmética de posições do anel. Só usa list.h e os
+ * bitmaps, então também compila em espaço de usuário contra os cabeçalhos de
+ * ../userspace/include (simulação e microbenchmarks em ../userspace).
+ *
+ * Nada aqui toma lock nem contabiliza estatísticas: no driver o chamador segura
+ * proc->lock e cuida do orçamento global.
+ */
+#ifndef MQUEUE_CORE_H
+#define MQUEUE_CORE_H
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/bitops.h>
+#include <linux/bitmap.h>
+
+#include "mqueue.h"
+
+// Fila de prioridades: uma subfila FIFO por nível e um bitmap das não vazias. O
+// nível 0 é o mais urgente, então find_first_bit acha a próxima a entregar e
+// find_last_bit a primeira a descartar, sem percorrer mensagens.
+struct mq_prio_queue {
+    struct list_head lists[MQUEUE_PRIO_MAX];
+    DECLARE_BITMAP(map, MQUEUE_PRIO_MAX);
+    int count;                   // Mensagens na fila
+    unsigned long bytes;         // Conteúdo na fila
+};
+
+#define MQ_LEVEL_NONE MQUEUE_PRIO_MAX   // Nenhum nível: fila vazia ou nada a descartar
+
+// Nível de uma prioridade da API (0 = padrão, MQUEUE_PRIO_MAX - 1 = mais urgente).
+// A conversão é simétrica: também leva o nível de volta à prioridade.
+static inline unsigned int mq_prio_level(unsigned int prio) {
+    return MQUEUE_PRIO_MAX - 1 - prio;
+}
+
+static inline void mq_pq_init(struct mq_prio_queue *pq) {
+    int i;
+
+    for (i = 0; i < MQUEUE_PRIO_MAX; i++) {
+        INIT_LIST_HEAD(&pq->lists[i]);
+    }
+    bitmap_zero(pq->map, MQUEUE_PRIO_MAX);
+    pq->count = 0;
+    pq->bytes = 0;
+}
+
+// Enfileira link no fim da subfila level
+static inline void mq_pq_push(struct mq_prio_queue *pq, struct list_head *link, unsigned int level, unsigned int size) {
+    list_add_tail(link, &pq->lists[level]);
+    __set_bit(level, pq->map);   // Sob o lock do chamador: não precisa da versão atômica
+    pq->count++;
+    pq->bytes += size;
+}
+
+// Primeiro elemento da prioridade mais alta (*level recebe o nível), ou NULL com a fila vazia
+static inline struct list_head *mq_pq_peek(struct mq_prio_queue *pq, unsigned int *level) {
+    *level = find_first_bit(pq->map, MQUEUE_PRIO_MAX);
+    return *level < MQUEUE_PRIO_MAX ? pq->lists[*level].next : NULL;
+}
+
+// Tira link (enfileirado em level com size bytes) da fila
+static inline void mq_pq_remove(struct mq_prio_queue *pq, struct list_head *link, unsigned int level, unsigned int size) {
+    list_del(link);
+    if (list_empty(&pq->lists[level])) {
+        __clear_bit(level, pq->map);
+    }
+    pq->count--;
+    pq->bytes -= size;
+}
+
+// Nível da próxima vítima para abrir espaço a uma mensagem de new_level: o mais
+// antigo da prioridade mais baixa. MQ_LEVEL_NONE se a fila está vazia ou só tem
+// mensagens mais urgentes que a nova, que nunca são descartadas por ela.
+static inline unsigned int mq_pq_victim_level(struct mq_prio_queue *pq, unsigned int new_level) {
+    unsigned int lowest = find_last_bit(pq->map, MQUEUE_PRIO_MAX);
+
+    return lowest < MQUEUE_PRIO_MAX && lowest >= new_level ? lowest : MQ_LEVEL_NONE;
+}
+
+// Esvazia a fila em list, da prioridade mais alta para a mais baixa.
+// Retorna os bytes retirados.
+static inline unsigned long mq_pq_take_all(struct mq_prio_queue *pq, struct list_head *list) {
+    unsigned long bytes = pq->bytes;
+    unsigned int level;
+
+    for_each_set_bit(level, pq->map, MQUEUE_PRIO_MAX) {
+        list_splice_tail_init(&pq->lists[level], list);
+    }
+    bitmap_zero(pq->map, MQUEUE_PRIO_MAX);
+    pq->count = 0;
+    pq->bytes = 0;
+    return bytes;
+}
+
+// Anel: head e tail são contadores livres (só crescem, com volta em 2^32), então
+// head - tail é o número de mensagens mesmo depois da volta.
+
+// tail limitado a no máximo slots mensagens atrás de head. Com o anel mapeado o
+// tail vem do consumidor e não é confiável.
+static inline unsigned int mq_ring_clamp_tail(unsigned int head, unsigned int tail, unsigned int slots) {
+    return head - tail > slots ? head - slots : tail;
+}
+
+// Deslocamento do slot da posição pos a partir do primeiro slot. slots é potência
+// de 2, que divide 2^32: posições consecutivas caem em slots vizinhos também na volta
+// dos contadores (com pos % 5, 0xffffffff e 0 cairiam no mesmo slot).
+static inline size_t mq_ring_slot_offset(unsigned int pos, unsigned int slots, unsigned int slot_size) {
+    return (size_t)(pos & (slots - 1)) * slot_size;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Tracepoints do driver mqueue (t2.c), em /sys/kernel/tracing/events/mqueue.
+ * Desligados custam um desvio estático; os eventos registram só o handle do
+ * processo (o nome aparece em /sys/kernel/debug/mqueue/<dispositivo>/endpoints).
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mqueue
+
+#if !defined(_MQUEUE_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MQUEUE_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// Mensagem entrou na fila; depth já conta a mensagem nova
+TRACE_EVENT(mqueue_enqueue,
+    TP_PROTO(int handle, unsigned int size, unsigned int depth),
+    TP_ARGS(handle, size, depth),
+    TP_STRUCT__entry(
+        __field(int, handle)
+        __field(unsigned int, size)
+        __field(unsigned int, depth)
+    ),
+    TP_fast_assign(
+        __entry->handle = handle;
+        __entry->size = size;
+        __entry->depth = depth;
+    ),
+    TP_printk("handle=%d size=%u depth=%u", __entry->handle, __entry->size, __entry->depth)
+);
+
+// Mensagem saiu da fila para o consumidor; depth já desconta a mensagem
+TRACE_EVENT(mqueue_dequeue,
+    TP_PROTO(int handle, unsigned int size, unsigned int depth),
+    TP_ARGS(handle, size, depth),
+    TP_STRUCT__entry(
+        __field(int, handle)
+        __field(unsigned int, size)
+        __field(unsigned int, depth)
+    ),
+    TP_fast_assign(
+        __entry->handle = handle;
+        __entry->size = size;
+        __entry->depth = depth;
+    ),
+    TP_printk("handle=%d size=%u depth=%u", __entry->handle, __entry->size, __entry->depth)
+);
+
+// Mensagem perdida por fila cheia: oldest = a mais antiga foi descartada,
+// senão a nova foi recusada
+TRACE_EVENT(mqueue_drop,
+    TP_PROTO(int handle, unsigned int size, bool oldest),
+    TP_ARGS(handle, size, oldest),
+    TP_STRUCT__entry(
+        __field(int, handle)
+        __field(unsigned int, size)
+        __field(bool, oldest)
+    ),
+    TP_fast_assign(
+        __entry->handle = handle;
+        __entry->size = size;
+        __entry->oldest = oldest;
+    ),
+    TP_printk("handle=%d size=%u %s", __entry->handle, __entry->size,
+              __entry->oldest ? "oldest" : "new")
+);
+
+#endif
+
+// O cabeçalho fica fora de include/trace/events: define_trace.h o procura aqui
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mqueue_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,100 @@
+/*
+ * Consumidor do anel mapeado do mqueue (carregar o módulo com queue_mode=1).
+ * Registra um processo, mapeia o seu anel e imprime as mensagens lidas
+ * direto da memória compartilhada; o único syscall por rajada é o poll()
+ * que espera mensagens novas.
+ *
+ * Uso: ring_reader nome
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "mqueue.h"
+
+#define BUFFER_LENGTH 64
+#define RING_MAP_SIZE (1 << 20)    // Limite do mapeamento; o driver informa o tamanho real
+
+int main(int argc, char *argv[]) {
+    struct mqueue_ring_ctrl *ctrl;
+    char command[BUFFER_LENGTH];
+    struct pollfd pfd;
+    size_t map_size;
+    char *base;
+    int fd, len;
+
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s nome\n", argv[0]);
+        return 1;
+    }
+
+    fd = open(MQUEUE_DEVICE, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open the device...");
+        return errno;
+    }
+
+    len = snprintf(command, sizeof(command), "/reg %s", argv[1]);
+    if (write(fd, command, len) < 0) {
+        perror("Failed to register");
+        return errno;
+    }
+
+    // Mapeia primeiro só a página de controle para descobrir o tamanho do anel
+    ctrl = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ctrl == MAP_FAILED) {
+        perror("Failed to map the ring (queue_mode=1?)");
+        return errno;
+    }
+    map_size = ctrl->data_offset + (size_t)ctrl->slots * ctrl->slot_size;
+    munmap(ctrl, sysconf(_SC_PAGESIZE));
+    if (map_size > RING_MAP_SIZE) {
+        fprintf(stderr, "Ring too large: %zu bytes\n", map_size);
+        return 1;
+    }
+
+    base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("Failed to map the ring");
+        return errno;
+    }
+    ctrl = (struct mqueue_ring_ctrl *)base;
+    printf("Ring mapped: %u slots of %u bytes\n", ctrl->slots, ctrl->slot_size);
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (;;) {
+        unsigned int head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+        unsigned int tail = ctrl->tail;
+
+        if (tail == head) {         // Vazio: dorme até o driver publicar algo
+            if (poll(&pfd, 1, -1) < 0) {
+                perror("poll");
+                break;
+            }
+            if (pfd.revents & POLLHUP) {  // Processo desregistrado
+                break;
+            }
+            continue;
+        }
+
+        while (tail != head) {      // Drena sem syscall
+            struct mqueue_ring_slot *slot = (struct mqueue_ring_slot *)
+                (base + ctrl->data_offset + (size_t)(tail & (ctrl->slots - 1)) * ctrl->slot_size);
+
+            printf("Read message from ring: [%.*s]\n", slot->size, slot->data);
+            tail++;
+        }
+        __atomic_store_n(&ctrl->tail, tail, __ATOMIC_RELEASE);  // Libera os slots para o driver
+    }
+
+    munmap(base, map_size);
+    close(fd);
+    return 0;
+}
@@ -6,331 +6,2112 @@
 #include <linux/uaccess.h>
 #include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/rculist.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
+#include <linux/refcount.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/sched/signal.h>
+#include <linux/idr.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kref.h>
+#include <linux/capability.h>
+#include <linux/ctype.h>
+#include <linux/stringify.h>
+#include <linux/log2.h>
+
+#include "mqueue.h"                // Layout do anel compartilhado com o espaço de usuário
+#include "mqueue_core.h"           // Fila de prioridades e posições do anel, também compiladas fora do kernel
+#define CREATE_TRACE_POINTS
+#include "mqueue_trace.h"          // Tracepoints de enfileiramento, retirada e descarte
 
 // Definições do nome do dispositivo e da classe
-#define DEVICE_NAME "mqueue"     // Nome do dispositivo no /dev
+#define DEVICE_NAME "mqueue"     // Prefixo dos dispositivos no /dev: mqueue0..N-1 e mqueue-<nome>
 #define CLASS_NAME  "mqueue_class" // Nome da classe do dispositivo
+#define PROCESS_HASH_BITS 10       // Tabela de processos com 1024 buckets
+#define TOPIC_HASH_BITS   6        // Tabela de tópicos com 64 buckets
+#define MSG_INLINE_SIZE   96       // Mensagens até 95 bytes ficam dentro do próprio cabeçalho
+#define QUEUE_MODE_LIST   0        // Fila em lista ligada, uma alocação por mensagem
+#define QUEUE_MODE_RING   1        // Anel contíguo pré-alocado no registro, sem alocação no envio
+#define MQUEUE_MAX_MINORS 256      // register_chrdev reserva 256 minors: uma instância por minor
+#define MSG_SIZE_MAX      SHRT_MAX   // message_s.size é short
+#define CMD_OVERHEAD      (MQUEUE_NAME_LEN + 16)  // Comando, nome e separadores além da mensagem num write
+#define NAME_SCAN         "%" __stringify(MQUEUE_NAME_LEN) "s"  // Um byte a mais que o limite: nome longo é detectado
+
+// Informações do módulo
+MODULE_LICENSE("GPL");           
+MODULE_AUTHOR("Guilherme Martins Specht");
+MODULE_DESCRIPTION("Desenvolvimento do trabalho TP2 de CSO."); 
+MODULE_VERSION("0.1.0");         
+
+// Variáveis globais para o número principal e a classe do dispositivo
+static int majorNumber;          // Número principal do dispositivo
+static struct class *mqueueClass = NULL;  // Classe do dispositivo
+
+// Parâmetros configuráveis pelo usuário. Os limites são só os valores iniciais de cada
+// instância criada depois; os de uma instância existente ficam no sysfs do seu dispositivo.
+static int nr_instances = 1;     // Instâncias criadas na carga: /dev/mqueue0..N-1
+static int max_messages = 5;     // Número máximo de mensagens por processo
+static int max_msg_size = 250;   // Tamanho máximo de cada mensagem
+static int queue_mode = QUEUE_MODE_LIST;  // Armazenamento das filas (fixo enquanto o módulo está carregado)
+static unsigned long max_total_bytes;    // Orçamento de memória de todas as filas (0 = sem limite)
+static unsigned long max_queue_bytes;    // Cota de bytes de cada processo novo (0 = sem limite)
+static int overflow_policy = MQUEUE_OVERFLOW_DROP_OLDEST;  // Política de fila cheia de cada processo novo
+
+// Define os parâmetros que podem ser configurados pelo usuário no momento da carga do módulo.
+// Os limites são os valores iniciais de cada instância; depois da carga eles mudam por
+// instância em /sys/class/mqueue_class/<dispositivo>/.
+module_param(nr_instances, int, 0444);
+MODULE_PARM_DESC(nr_instances, "Número de dispositivos independentes criados na carga (/dev/mqueue0..N-1)"); // Descrição do parâmetro
+
+module_param(max_messages, int, 0444);  // Parâmetro de número máximo de mensagens
+MODULE_PARM_DESC(max_messages, "Número máximo de mensagens por processo"); // Descrição do parâmetro
+
+module_param(max_msg_size, int, 0444);  // Parâmetro de tamanho máximo de mensagens
+MODULE_PARM_DESC(max_msg_size, "Tamanho máximo de cada mensagem (bytes)"); // Descrição do parâmetro
+
+module_param(queue_mode, int, 0444);    // Só na carga: as filas existentes dependem do modo
+MODULE_PARM_DESC(queue_mode, "Armazenamento das filas: 0 = lista ligada, 1 = anel pré-alocado"); // Descrição do parâmetro
+
+module_param(max_total_bytes, ulong, 0444);
+MODULE_PARM_DESC(max_total_bytes, "Memória total das filas em bytes: conteúdo no modo lista, anéis inteiros no modo anel (0 = sem limite)"); // Descrição do parâmetro
+
+module_param(max_queue_bytes, ulong, 0444);
+MODULE_PARM_DESC(max_queue_bytes, "Cota de bytes por processo no modo lista, aplicada no registro (0 = sem limite)"); // Descrição do parâmetro
+
+module_param(overflow_policy, int, 0444);
+MODULE_PARM_DESC(overflow_policy, "Fila cheia, aplicada no registro: 0 = descarta a mais antiga, 1 = descarta a nova, 2 = recusa com EAGAIN, 3 = bloqueia o escritor"); // Descrição do parâmetro
+
+static bool debug;                       // Diagnósticos no log do kernel (desligados por padrão)
+module_param(debug, bool, 0644);
+MODULE_PARM_DESC(debug, "Mensagens de diagnóstico no log do kernel, limitadas em taxa"); // Descrição do parâmetro
+
+// Diagnóstico fora do caminho normal: só com debug=1 e nunca mais que a taxa do printk_ratelimited.
+// O conteúdo das mensagens não vai para o log; os eventos do caminho quente são tracepoints.
+#define mq_dbg(fmt, ...) \
+    do { \
+        if (unlikely(debug)) { \
+            printk_ratelimited(KERN_INFO "Mqueue Driver: " fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Contadores de uma instância, uma cópia por CPU: o caminho quente só incrementa a cópia
+// local, sem atômicos nem linhas de cache compartilhadas. O arquivo stats da instância em
+// /sys/kernel/debug/mqueue/ soma as cópias.
+// Do tamanho da palavra para a leitura sem lock nunca ver um valor pela metade.
+struct mqueue_stats {
+    unsigned long enqueued;      // Mensagens enfileiradas
+    unsigned long dequeued;      // Mensagens entregues a um leitor
+    unsigned long dropped;       // Perdidas por fila cheia (a mais antiga ou a nova)
+    unsigned long rejected_oversize;  // Recusadas por exceder max_msg_size
+    unsigned long bytes_in;      // Conteúdo enfileirado
+    unsigned long bytes_out;     // Conteúdo entregue
+    unsigned long rejected_full; // Envios recusados com EAGAIN por fila cheia
+    unsigned long blocked;       // Vezes que um escritor dormiu esperando espaço
+};
+
+static struct dentry *debug_dir;     // /sys/kernel/debug/mqueue, um diretório por instância
+
+// Instância do mqueue: um dispositivo com registro de processos, tópicos, limites e
+// estatísticas próprios. Aplicações em instâncias diferentes não compartilham nenhum
+// lock nem contador. As instâncias da carga vivem até a saída do módulo; as criadas
+// com MQUEUE_IOC_CREATE_INSTANCE podem ser destruídas antes, e a memória fica até o
+// último arquivo aberto e o último processo soltarem suas referências.
+struct mq_instance {
+    struct kref ref;             // Criação + arquivos abertos + processos
+    int minor;                   // Minor do dispositivo e chave em instance_idr
+    bool dynamic;                // Criada por ioctl: pode ser destruída por ioctl
+    // Limites, ajustáveis em /sys/class/mqueue_class/<dispositivo>/
+    int max_messages;
+    int max_msg_size;
+    unsigned long max_total_bytes;   // Orçamento de memória das filas (0 = sem limite)
+    unsigned long max_queue_bytes;   // Cota de bytes de cada processo novo (0 = sem limite)
+    int overflow_policy;             // Política de fila cheia de cada processo novo
+    // Processos registrados, indexados por nome: envio, /read e /unreg fazem a busca em O(1)
+    DECLARE_HASHTABLE(process_table, PROCESS_HASH_BITS);
+    // Índice por handle da API binária (ioctl); busca sob RCU como a tabela hash
+    struct idr process_idr;
+    struct mutex registry_lock;  // Serializa registro, desregistro e assinaturas
+    DECLARE_HASHTABLE(topic_table, TOPIC_HASH_BITS);
+    struct mqueue_stats __percpu *stats;
+    // Bytes cobrados de max_total_bytes: conteúdo das mensagens na fila (modo lista) e
+    // anéis alocados (modo anel). Atualizado sempre, mesmo sem limite, para as estatísticas.
+    atomic_long_t queued_bytes;
+    // Escritores com MQUEUE_OVERFLOW_BLOCK esperando espaço. Uma fila só para todos: a
+    // falta de espaço pode ser do orçamento global, que qualquer leitura libera.
+    wait_queue_head_t space_wq;
+    struct device *device;
+    struct dentry *debug_dir;
+    char name[MQUEUE_NAME_LEN + sizeof(DEVICE_NAME)];  // Nome do dispositivo no /dev
+};
+
+// Instâncias por minor; open faz a busca aqui
+static DEFINE_IDR(instance_idr);
+static DEFINE_MUTEX(instance_lock);  // Serializa criação, destruição e open
+
+// Estado de um arquivo aberto (private_data)
+struct mq_client {
+    struct mq_instance *inst;    // Instância do dispositivo aberto; o arquivo segura uma referência
+    struct process_s *own;       // Processo registrado por este arquivo, ou NULL
+};
+
+// Conteúdo publicado num tópico: guardado uma vez e compartilhado pelas mensagens
+// de todos os assinantes (modo lista); a última mensagem liberada libera o conteúdo
+struct shared_payload {
+    refcount_t refs;             // Publicador durante o envio + uma por mensagem enfileirada
+    short size;                  // Tamanho do conteúdo
+    char data[];                 // Conteúdo terminado em '\0'
+};
+
+// Definir a estrutura para armazenar as mensagens
+// Os cabeçalhos vêm de um kmem_cache próprio (msg_cache). Conteúdos pequenos ficam em
+// inline_data, sem segunda alocação; os maiores são alocados com o tamanho exato.
+struct message_s {
+    struct list_head link;       // Estrutura de lista ligada para conectar as mensagens
+    char *message;               // Conteúdo da mensagem: inline_data, alocado com o tamanho exato ou shared->data
+    short size;                  // Tamanho da mensagem
+    unsigned char level;         // Subfila de prioridade (mq_prio_level), modo lista
+    struct shared_payload *shared;  // Conteúdo de um tópico, ou NULL
+    char inline_data[MSG_INLINE_SIZE];  // Armazenamento das mensagens pequenas
+};
+
+static struct kmem_cache *msg_cache;  // Slab dos cabeçalhos de mensagem
+
+// Definir a estrutura para armazenar processos
+//
+// Concorrência: o registro (tabela hash e idr) é consultado sob RCU (envio e leitura
+// não bloqueiam o registro) e só é alterado com registry_lock. A fila de mensagens de
+// cada processo tem seu próprio spinlock, então produtores enviando para destinos
+// diferentes nunca disputam o mesmo lock. Um processo desregistrado é marcado como
+// dead sob o seu lock e liberado só após um grace period do RCU.
+//
+// Cada arquivo aberto registra no máximo um processo e fica vinculado a ele em
+// mq_client: as operações sobre o próprio processo não fazem busca, e o
+// fechamento do arquivo desregistra o processo se o /unreg não foi feito.
+//
+// Referências: o registro guarda uma, o arquivo vinculado outra e cada mapeamento
+// do anel mais uma. A memória só é liberada quando a última é solta.
+struct process_s {
+    struct hlist_node hnode;     // Entrada na tabela hash indexada pelo nome (RCU)
+    struct mq_instance *inst;    // Instância onde o processo está registrado (referência própria)
+    pid_t pid;                   // PID do processo
+    int handle;                  // Identificador da API binária (process_idr)
+    unsigned int hash;           // Hash do nome, calculado uma vez no registro
+    spinlock_t lock;             // Protege a fila (lista ou anel) e dead
+    struct mq_prio_queue queue;  // Modo lista: subfilas por prioridade, contador de mensagens e bytes
+    unsigned long quota_bytes;   // Limite de bytes na fila, 0 = sem limite (modo lista)
+    int policy;                  // MQUEUE_OVERFLOW_*: fila cheia num envio direto
+    struct list_head subs;       // Assinaturas de tópicos deste processo (registry_lock)
+    // Modo anel: a geometria é fixada no registro, mudar max_messages depois não afeta o processo.
+    // A área (controle + slots) vem de vmalloc_user para poder ser mapeada pelo consumidor.
+    struct mqueue_ring_ctrl *ring;  // Página de controle; o tail mora aqui
+    char *ring_data;             // Primeiro slot
+    unsigned long ring_bytes;    // Tamanho da área mapeável
+    unsigned int ring_slots;     // Capacidade do anel, potência de 2 (max_messages arredondado para cima)
+    unsigned int ring_slot_size; // Bytes por slot, alinhado
+    unsigned int ring_head;      // Cópia privada do head: o valor na página compartilhada só é escrito
+    unsigned int mapped;         // VMAs do anel no consumidor (lock); com alguma ele avança o tail, o kernel não descarta
+    bool dead;                   // Desregistrado: não aceita mais mensagens
+    unsigned int depth_hwm;      // Maior profundidade da fila já vista (lock)
+    unsigned long dropped;       // Mensagens perdidas por fila cheia (lock)
+    unsigned long blocked;       // Vezes que um escritor esperou espaço nesta fila (lock)
+    refcount_t refs;             // Registro + arquivo vinculado
+    wait_queue_head_t wq;        // Leitores bloqueados e poll esperando mensagens
+    struct rcu_head rcu;         // Liberação adiada até os leitores RCU terminarem
+    char name[];                 // Nome do processo, alocado junto com a estrutura no tamanho exato
+};
+
+// Tópico de publish/subscribe. Existe enquanto tiver assinantes; a publicação
+// percorre os assinantes sob RCU, assinar e cancelar usam registry_lock.
+struct topic_s {
+    struct hlist_node hnode;     // Entrada em topic_table (RCU)
+    unsigned int hash;           // Hash do nome
+    struct list_head subs;       // Assinaturas (RCU)
+    struct rcu_head rcu;
+    char name[];
+};
+
+// Assinatura de um processo num tópico
+struct subscription_s {
+    struct list_head topic_link; // Em topic->subs (RCU)
+    struct list_head proc_link;  // Em proc->subs
+    struct topic_s *topic;
+    struct process_s *proc;
+    int policy;                  // MQUEUE_OVERFLOW_*: o que fazer com a fila deste assinante cheia
+    struct rcu_head rcu;
+};
+
+// Última referência à instância: o dispositivo já foi removido e não há processos
+static void instance_release(struct kref *ref) {
+    struct mq_instance *inst = container_of(ref, struct mq_instance, ref);
+
+    idr_destroy(&inst->process_idr);
+    free_percpu(inst->stats);
+    kfree(inst);
+}
+
+// Solta uma referência à instância; pode ser chamada de um callback do RCU
+static void instance_put(struct mq_instance *inst) {
+    kref_put(&inst->ref, instance_release);
+}
+
+// Solta uma referência ao conteúdo compartilhado
+static void payload_put(struct shared_payload *payload) {
+    if (refcount_dec_and_test(&payload->refs)) {
+        kfree(payload);
+    }
+}
+
+// Libera uma mensagem e seu conteúdo
+static void free_message(struct message_s *msg) {
+    if (msg->shared) {
+        payload_put(msg->shared);  // O conteúdo pode continuar na fila de outros assinantes
+    } else if (msg->message != msg->inline_data) {
+        kfree(msg->message);     // Libera a memória da mensagem
+    }
+    kmem_cache_free(msg_cache, msg);  // Devolve o cabeçalho ao slab
+}
+
+// Libera todas as mensagens de uma lista já desligada do processo
+static void free_message_list(struct list_head *list) {
+    struct message_s *msg, *tmp;
+
+    list_for_each_entry_safe(msg, tmp, list, link) {
+        list_del(&msg->link);
+        free_message(msg);
+    }
+}
+
+// Callback do RCU: nenhum leitor enxerga mais o processo nem o seu anel
+static void free_process_rcu(struct rcu_head *head) {
+    struct process_s *proc = container_of(head, struct process_s, rcu);
+
+    if (proc->ring) {
+        atomic_long_sub(proc->ring_bytes, &proc->inst->queued_bytes);  // O anel volta para o orçamento
+    }
+    vfree(proc->ring);           // vfree adia sozinho quando chamado fora de contexto de processo
+    instance_put(proc->inst);
+    kfree(proc);
+}
+
+// Solta uma referência; a última libera o processo após o grace period
+static void process_put(struct process_s *proc) {
+    if (refcount_dec_and_test(&proc->refs)) {
+        call_rcu(&proc->rcu, free_process_rcu);
+    }
+}
+
+// Tail atual do anel. Com o anel mapeado o valor vem do espaço de usuário e é
+// limitado para nunca apontar para fora das mensagens publicadas.
+static unsigned int ring_tail(struct process_s *proc) {
+    return mq_ring_clamp_tail(proc->ring_head, smp_load_acquire(&proc->ring->tail), proc->ring_slots);
+}
+
+// Número de mensagens na fila, em qualquer modo
+static int process_msg_count(struct process_s *proc) {
+    if (proc->ring) {
+        return READ_ONCE(proc->ring_head) - ring_tail(proc);
+    }
+    return READ_ONCE(proc->queue.count);
+}
+
+// Há algo para o leitor vinculado: mensagens na fila ou o processo foi desregistrado
+static bool process_readable(struct process_s *proc) {
+    return process_msg_count(proc) > 0 || READ_ONCE(proc->dead);
+}
+
+// Slot do anel correspondente ao contador livre pos
+static struct mqueue_ring_slot *ring_slot_at(struct process_s *proc, unsigned int pos) {
+    return (struct mqueue_ring_slot *)(proc->ring_data + mq_ring_slot_offset(pos, proc->ring_slots, proc->ring_slot_size));
+}
+
+// Tamanho de uma mensagem do anel; limitado porque a página pode ser escrita pelo consumidor
+static unsigned int ring_slot_len(struct process_s *proc, struct mqueue_ring_slot *slot) {
+    return min_t(unsigned int, READ_ONCE(slot->size), proc->ring_slot_size - sizeof(*slot) - 1);
+}
+
+// Contabilidade do caminho quente, chamada com proc->lock. Só contadores por CPU e
+// tracepoints (um desvio estático quando desligados); nada de printk aqui.
+static void note_enqueue(struct process_s *proc, unsigned int size) {
+    unsigned int depth = process_msg_count(proc);
+
+    if (depth > proc->depth_hwm) {
+        proc->depth_hwm = depth;
+    }
+    this_cpu_inc(proc->inst->stats->enqueued);
+    this_cpu_add(proc->inst->stats->bytes_in, size);
+    trace_mqueue_enqueue(proc->handle, size, depth);
+}
+
+static void note_dequeue(struct process_s *proc, unsigned int size) {
+    this_cpu_inc(proc->inst->stats->dequeued);
+    this_cpu_add(proc->inst->stats->bytes_out, size);
+    trace_mqueue_dequeue(proc->handle, size, process_msg_count(proc));
+}
+
+// oldest: a mensagem mais antiga saiu para dar lugar à nova; senão a nova foi recusada
+static void note_drop(struct process_s *proc, unsigned int size, bool oldest) {
+    proc->dropped++;
+    this_cpu_inc(proc->inst->stats->dropped);
+    trace_mqueue_drop(proc->handle, size, oldest);
+}
+
+// Mensagem maior que max_msg_size, recusada antes de chegar a uma fila
+static void note_oversize(struct mq_instance *inst, size_t size) {
+    this_cpu_inc(inst->stats->rejected_oversize);
+    mq_dbg("message of %zu bytes exceeds max_msg_size %d\n", size, READ_ONCE(inst->max_msg_size));
+}
+
+// Cobra size bytes do orçamento da instância; falha sem cobrar se o orçamento estourar
+static bool charge_bytes(struct mq_instance *inst, unsigned long size) {
+    unsigned long budget = READ_ONCE(inst->max_total_bytes);
+
+    if (atomic_long_add_return(size, &inst->queued_bytes) > budget && budget) {
+        atomic_long_sub(size, &inst->queued_bytes);
+        return false;
+    }
+    return true;
+}
+
+// Acorda os escritores bloqueados depois que bytes ou slots foram liberados
+static void wake_writers(struct mq_instance *inst) {
+    if (wq_has_sleeper(&inst->space_wq)) {   // Barreira incluída; sem escritores esperando não toca no lock da fila
+        wake_up_interruptible(&inst->space_wq);
+    }
+}
+
+// Mensagem mais antiga da prioridade mais alta, ou NULL com a fila vazia. Chamada com proc->lock.
+static struct message_s *list_peek(struct process_s *proc) {
+    unsigned int level;
+    struct list_head *link = mq_pq_peek(&proc->queue, &level);
+
+    return link ? list_entry(link, struct message_s, link) : NULL;
+}
+
+// Tira msg da lista de proc e devolve os bytes à cota e ao orçamento. Chamada com proc->lock.
+static void list_unqueue(struct process_s *proc, struct message_s *msg) {
+    mq_pq_remove(&proc->queue, &msg->link, msg->level, msg->size);
+    atomic_long_sub(msg->size, &proc->inst->queued_bytes);
+}
+
+// A fila em modo lista aceita mais size bytes sem contar o orçamento global.
+// Também é usada sem o lock como condição de espera dos escritores bloqueados.
+static bool list_has_room(struct process_s *proc, size_t size) {
+    unsigned long quota = READ_ONCE(proc->quota_bytes);
+
+    return READ_ONCE(proc->queue.count) < READ_ONCE(proc->inst->max_messages) && (!quota || READ_ONCE(proc->queue.bytes) + size <= quota);
+}
+
+// Condição de espera de um escritor bloqueado em proc: há espaço ou o envio vai falhar
+static bool queue_writable(struct process_s *proc, size_t size) {
+    unsigned long budget = READ_ONCE(proc->inst->max_total_bytes);
+
+    if (READ_ONCE(proc->dead) || READ_ONCE(proc->policy) != MQUEUE_OVERFLOW_BLOCK) {
+        return true;                 // A nova tentativa falha ou segue a política nova
+    }
+    if (proc->ring) {
+        return process_msg_count(proc) < proc->ring_slots;
+    }
+    return list_has_room(proc, size) && (!budget || atomic_long_read(&proc->inst->queued_bytes) + size <= budget);
+}
+
+// Fila cheia e a política não descarta a mais antiga (ou não pode: anel mapeado ou
+// fila já vazia com o orçamento global esgotado). Chamada com proc->lock.
+// Retorna QUEUE_FULL_WAIT se o escritor deve dormir em space_wq e tentar de novo.
+#define QUEUE_FULL_WAIT 1
+static int queue_full(struct process_s *proc, size_t size, int policy) {
+    switch (policy) {
+    case MQUEUE_OVERFLOW_BLOCK:
+        if (!proc->mapped) {         // O consumidor do anel mapeado não passa pelo kernel para acordá-lo
+            proc->blocked++;
+            this_cpu_inc(proc->inst->stats->blocked);
+            return QUEUE_FULL_WAIT;
+        }
+        fallthrough;
+    case MQUEUE_OVERFLOW_REJECT:
+        this_cpu_inc(proc->inst->stats->rejected_full);
+        return -EAGAIN;
+    case MQUEUE_OVERFLOW_DROP_OLDEST:
+        if (proc->mapped) {          // O tail é do consumidor: não dá para descartar a mais antiga
+            this_cpu_inc(proc->inst->stats->rejected_full);
+            return -EAGAIN;
+        }
+        fallthrough;
+    default:
+        note_drop(proc, size, false);
+        return -ENOBUFS;
+    }
+}
+
+// Enfileira no anel. Com o anel cheio aplica policy: MQUEUE_OVERFLOW_DROP_OLDEST
+// sobrescreve a mais antiga só avançando o tail (se o anel não está mapeado: aí o
+// tail é do consumidor). Chamada com proc->lock.
+// Retorna 0 ou o resultado de queue_full().
+static int ring_push(struct process_s *proc, const char *data, short size, int policy) {
+    struct mqueue_ring_slot *slot;
+    unsigned int tail = ring_tail(proc);
+
+    if (proc->ring_head - tail == proc->ring_slots) {
+        if (policy != MQUEUE_OVERFLOW_DROP_OLDEST || proc->mapped) {
+            return queue_full(proc, size, policy);
+        }
+        note_drop(proc, ring_slot_len(proc, ring_slot_at(proc, tail)), true);
+        smp_store_release(&proc->ring->tail, tail + 1);  // Descarta a mais antiga
+    }
+
+    slot = ring_slot_at(proc, proc->ring_head);
+    slot->size = size;
+    memcpy(slot->data, data, size);
+    slot->data[size] = '\0';
+    WRITE_ONCE(proc->ring_head, proc->ring_head + 1);
+    smp_store_release(&proc->ring->head, proc->ring_head);  // Publica o slot para o consumidor
+    note_enqueue(proc, size);
+    return 0;
+}
+
+// Hash de um nome de processo
+static unsigned int process_name_hash(const char *name) {
+    return full_name_hash(NULL, name, strlen(name));
+}
+
+// Busca um processo pelo nome; deve ser chamada dentro de rcu_read_lock() ou com registry_lock
+static struct process_s *find_process_rcu(struct mq_instance *inst, const char *name) {
+    struct process_s *proc;
+    unsigned int hash = process_name_hash(name);
+
+    hash_for_each_possible_rcu(inst->process_table, proc, hnode, hash, lockdep_is_held(&inst->registry_lock)) {
+        if (proc->hash == hash && strcmp(proc->name, name) == 0) {  // Compara o hash antes da string
+            return proc;
+        }
+    }
+    return NULL;
+}
+
+// Busca um tópico pelo nome; dentro de rcu_read_lock() ou com registry_lock
+static struct topic_s *find_topic_rcu(struct mq_instance *inst, const char *name) {
+    struct topic_s *topic;
+    unsigned int hash = process_name_hash(name);
+
+    hash_for_each_possible_rcu(inst->topic_table, topic, hnode, hash, lockdep_is_held(&inst->registry_lock)) {
+        if (topic->hash == hash && strcmp(topic->name, name) == 0) {
+            return topic;
+        }
+    }
+    return NULL;
+}
+
+// Remove uma assinatura; o tópico some junto com o último assinante. Chamada com registry_lock.
+static void drop_subscription(struct subscription_s *sub) {
+    struct topic_s *topic = sub->topic;
+
+    list_del_rcu(&sub->topic_link);  // Publicações em andamento ainda podem vê-la
+    list_del(&sub->proc_link);
+    kfree_rcu(sub, rcu);
+    if (list_empty(&topic->subs)) {
+        hash_del_rcu(&topic->hnode);
+        kfree_rcu(topic, rcu);
+    }
+}
+
+// Cancela todas as assinaturas de um processo; chamada com registry_lock
+static void drop_subscriptions(struct process_s *proc) {
+    struct subscription_s *sub, *tmp;
+
+    list_for_each_entry_safe(sub, tmp, &proc->subs, proc_link) {
+        drop_subscription(sub);
+    }
+}
+
+// Assina um tópico (criado na primeira assinatura) para o processo do arquivo
+static int subscribe_topic(struct process_s *own, const char *name, int policy) {
+    struct subscription_s *sub;
+    struct topic_s *topic;
+    size_t name_len = strlen(name);
+
+    if (policy != MQUEUE_OVERFLOW_DROP_OLDEST && policy != MQUEUE_OVERFLOW_DROP_NEW) {
+        return -EINVAL;
+    }
+
+    sub = kmalloc(sizeof(*sub), GFP_KERNEL);
+    if (!sub) {
+        return -ENOMEM;
+    }
+
+    mutex_lock(&own->inst->registry_lock);
+    if (own->dead) {
+        mutex_unlock(&own->inst->registry_lock);
+        kfree(sub);
+        return -EINVAL;
+    }
+    topic = find_topic_rcu(own->inst, name);
+    if (topic) {
+        struct subscription_s *cur;
+
+        list_for_each_entry(cur, &own->subs, proc_link) {
+            if (cur->topic == topic) {   // Já assinado
+                mutex_unlock(&own->inst->registry_lock);
+                kfree(sub);
+                return -EEXIST;
+            }
+        }
+    } else {
+        topic = kmalloc(sizeof(*topic) + name_len + 1, GFP_KERNEL);
+        if (!topic) {
+            mutex_unlock(&own->inst->registry_lock);
+            kfree(sub);
+            return -ENOMEM;
+        }
+        memcpy(topic->name, name, name_len + 1);
+        topic->hash = process_name_hash(name);
+        INIT_LIST_HEAD(&topic->subs);
+        hash_add_rcu(own->inst->topic_table, &topic->hnode, topic->hash);
+    }
+
+    sub->topic = topic;
+    sub->proc = own;
+    sub->policy = policy;
+    list_add_tail_rcu(&sub->topic_link, &topic->subs);
+    list_add_tail(&sub->proc_link, &own->subs);
+    mutex_unlock(&own->inst->registry_lock);
+    mq_dbg("process %s subscribed to topic %s\n", own->name, name);
+    return 0;
+}
+
+// Cancela a assinatura do processo do arquivo num tópico
+static int unsubscribe_topic(struct process_s *own, const char *name) {
+    struct subscription_s *sub;
+
+    mutex_lock(&own->inst->registry_lock);
+    list_for_each_entry(sub, &own->subs, proc_link) {
+        if (strcmp(sub->topic->name, name) == 0) {
+            drop_subscription(sub);
+            mutex_unlock(&own->inst->registry_lock);
+            return 0;
+        }
+    }
+    mutex_unlock(&own->inst->registry_lock);
+    return -ENOENT;
+}
+
+// Busca um processo pelo handle; mesmas regras de find_process_rcu
+static struct process_s *find_process_handle_rcu(struct mq_instance *inst, int handle) {
+    return handle > 0 ? idr_find(&inst->process_idr, handle) : NULL;
+}
+
+// Função para registrar um processo e inicializar sua lista de mensagens
+// O processo fica vinculado ao arquivo de client, que passa a segurar uma referência a ele.
+// Retorna o handle do processo ou um erro negativo.
+static int register_process(struct mq_client *client, char *name, pid_t pid) {
+    struct mq_instance *inst = client->inst;
+    size_t name_len = strlen(name);
+    struct process_s *new_proc;
+
+    if (READ_ONCE(client->own)) {  // Um processo por arquivo (confirmado sob o lock abaixo)
+        return -EBUSY;
+    }
+
+    new_proc = kmalloc(sizeof(struct process_s) + name_len + 1, GFP_KERNEL);  // Aloca o processo com espaço exato para o nome
+    if (!new_proc) {              // Verifica se a alocação foi bem-sucedida
+        mq_dbg("Memory allocation failed for process registration\n");
+        return -ENOMEM;
+    }
+
+    new_proc->inst = inst;
+    new_proc->ring = NULL;
+    new_proc->ring_head = 0;
+    new_proc->mapped = 0;
+    if (queue_mode == QUEUE_MODE_RING) {  // Toda a memória da fila é reservada aqui, o envio não aloca
+        new_proc->ring_slots = roundup_pow_of_two(max(READ_ONCE(inst->max_messages), 1));  // Potência de 2: o índice sobrevive à volta dos contadores
+        new_proc->ring_slot_size = ALIGN(sizeof(struct mqueue_ring_slot) + READ_ONCE(inst->max_msg_size) + 1, sizeof(long));
+        new_proc->ring_bytes = PAGE_SIZE + PAGE_ALIGN((unsigned long)new_proc->ring_slots * new_proc->ring_slot_size);
+        if (!charge_bytes(inst, new_proc->ring_bytes)) {  // O anel inteiro conta no orçamento desde já
+            kfree(new_proc);
+            mq_dbg("Memory budget exhausted, cannot register process %s\n", name);
+            return -ENOSPC;
+        }
+        new_proc->ring = vmalloc_user(new_proc->ring_bytes);  // Zerada e mapeável
+        if (!new_proc->ring) {
+            atomic_long_sub(new_proc->ring_bytes, &inst->queued_bytes);
+            kfree(new_proc);
+            mq_dbg("Memory allocation failed for process ring\n");
+            return -ENOMEM;
+        }
+        new_proc->ring_data = (char *)new_proc->ring + PAGE_SIZE;
+        new_proc->ring->magic = MQUEUE_RING_MAGIC;
+        new_proc->ring->slots = new_proc->ring_slots;
+        new_proc->ring->slot_size = new_proc->ring_slot_size;
+        new_proc->ring->data_offset = PAGE_SIZE;
+    }
+
+    memcpy(new_proc->name, name, name_len + 1);  // Copia o nome do processo para a estrutura
+    new_proc->hash = process_name_hash(name);
+    new_proc->pid = pid;           // Armazena o PID do processo
+    new_proc->quota_bytes = READ_ONCE(inst->max_queue_bytes);  // Ajustáveis depois com MQUEUE_IOC_SET_LIMITS
+    new_proc->policy = READ_ONCE(inst->overflow_policy);  // Validada na escrita do atributo
+    new_proc->dead = false;
+    new_proc->depth_hwm = 0;
+    new_proc->dropped = 0;
+    new_proc->blocked = 0;
+    refcount_set(&new_proc->refs, 1);  // Referência do registro
+    init_waitqueue_head(&new_proc->wq);
+    spin_lock_init(&new_proc->lock);
+    mq_pq_init(&new_proc->queue);  // Inicializa as listas de mensagens e o contador do processo
+    INIT_LIST_HEAD(&new_proc->subs);
+    kref_get(&inst->ref);          // Solta em free_process_rcu, inclusive nas falhas abaixo
+
+    mutex_lock(&inst->registry_lock);
+    if (client->own) {             // Outro /reg concorrente no mesmo arquivo venceu
+        mutex_unlock(&inst->registry_lock);
+        free_process_rcu(&new_proc->rcu);  // Nunca publicado: libera já, devolvendo o anel ao orçamento
+        return -EBUSY;
+    }
+    if (find_process_rcu(inst, name)) {  // Nomes são únicos: o envio precisa de um destino só
+        mutex_unlock(&inst->registry_lock);
+        free_process_rcu(&new_proc->rcu);
+        mq_dbg("Process name %s already registered\n", name);
+        return -EEXIST;
+    }
+    new_proc->handle = idr_alloc(&inst->process_idr, new_proc, 1, 0, GFP_KERNEL);
+    if (new_proc->handle < 0) {
+        int ret = new_proc->handle;
+
+        mutex_unlock(&inst->registry_lock);
+        free_process_rcu(&new_proc->rcu);
+        return ret;
+    }
+    // O vínculo é permanente: leituras, poll e mmap usam client->own sem lock
+    refcount_inc(&new_proc->refs);
+    WRITE_ONCE(client->own, new_proc);
+    hash_add_rcu(inst->process_table, &new_proc->hnode, new_proc->hash);  // Publica o processo para os leitores RCU
+    mutex_unlock(&inst->registry_lock);
+    mq_dbg("Process %s (PID: %d) registered successfully\n", name, pid);
+    
+    return new_proc->handle;
+}
+
+// Remove um processo do registro e descarta suas mensagens; chamada com registry_lock,
+// que é solto aqui antes de liberar as mensagens. Com o lock, dead indica se o
+// processo ainda está registrado.
+static void remove_process(struct process_s *proc) {
+    struct mq_instance *inst = proc->inst;
+    LIST_HEAD(discarded);          // Mensagens retiradas da fila, liberadas fora do lock
+
+    hash_del_rcu(&proc->hnode);    // Remove o processo dos índices; leitores RCU ainda podem vê-lo
+    idr_remove(&inst->process_idr, proc->handle);
+    drop_subscriptions(proc);      // Publicações novas não chegam mais aqui
+
+    // Envios em andamento verificam dead sob o lock e desistem
+    spin_lock(&proc->lock);
+    proc->dead = true;
+    atomic_long_sub(mq_pq_take_all(&proc->queue, &discarded), &inst->queued_bytes);  // O anel fica até a última referência (pode estar mapeado)
+    spin_unlock(&proc->lock);
+    mutex_unlock(&inst->registry_lock);
+
+    wake_up_interruptible(&proc->wq);  // Leitores bloqueados veem dead e retornam
+    wake_writers(inst);              // Escritores bloqueados nesta fila também, e o orçamento foi liberado
+
+    free_message_list(&discarded);  // Remove todas as mensagens associadas ao processo
+    mq_dbg("Process %s (PID: %d) unregistered and messages discarded\n", proc->name, proc->pid);
+    process_put(proc);             // Solta a referência do registro
+}
+
+// Função para desregistrar um processo, removendo suas mensagens e liberando memória
+static int unregister_process(struct mq_instance *inst, char *name, pid_t pid) {
+    struct process_s *proc;
+
+    mutex_lock(&inst->registry_lock);
+    proc = find_process_rcu(inst, name);
+    if (proc && proc->pid == pid) {  // Verifica se o nome e o PID correspondem
+        remove_process(proc);
+        return 0;
+    }
+    mutex_unlock(&inst->registry_lock);
+
+    mq_dbg("Process %s (PID: %d) not found for unregistration\n", name, pid);  // Caso o processo não seja encontrado
+    return -EINVAL;
+}
+
+// Desregistra o processo vinculado ao arquivo, sem busca; nada a fazer se já foi desregistrado
+static void unregister_own(struct process_s *own) {
+    mutex_lock(&own->inst->registry_lock);
+    if (own->dead) {
+        mutex_unlock(&own->inst->registry_lock);
+        return;
+    }
+    remove_process(own);
+}
+
+// Desregistra pelo handle (API binária)
+static int unregister_handle(struct mq_instance *inst, int handle, pid_t pid) {
+    struct process_s *proc;
+
+    mutex_lock(&inst->registry_lock);
+    proc = find_process_handle_rcu(inst, handle);
+    if (proc && proc->pid == pid) {
+        remove_process(proc);
+        return 0;
+    }
+    mutex_unlock(&inst->registry_lock);
+    return proc ? -EPERM : -ENOENT;
+}
+
+// Função para alocar uma mensagem com o conteúdo copiado (pode dormir, chamada fora dos locks)
+static struct message_s *alloc_message(struct mq_instance *inst, const char *data, size_t size) {
+    struct message_s *new_msg;
+
+    // Verifica se o tamanho da mensagem excede o tamanho máximo permitido
+    if (size > READ_ONCE(inst->max_msg_size)) {
+        note_oversize(inst, size);
+        return ERR_PTR(-EINVAL);
+    }
+
+    new_msg = kmem_cache_alloc(msg_cache, GFP_KERNEL);  // Aloca o cabeçalho no slab (caminho rápido por CPU)
+    if (!new_msg) {                        // Verifica se a alocação foi bem-sucedida
+        mq_dbg("Memory allocation failed for message\n");
+        return ERR_PTR(-ENOMEM);
+    }
+
+    new_msg->size = size;            // Armazena o tamanho da mensagem
+    new_msg->shared = NULL;
+    if (new_msg->size < MSG_INLINE_SIZE) {
+        new_msg->message = new_msg->inline_data;  // Cabe no cabeçalho
+    } else {
+        new_msg->message = kmalloc(new_msg->size + 1, GFP_KERNEL);  // Aloca só o tamanho do conteúdo
+        if (!new_msg->message) {          // Verifica se a alocação foi bem-sucedida
+            kmem_cache_free(msg_cache, new_msg);  // Libera a estrutura da mensagem se a alocação falhar
+            mq_dbg("Memory allocation failed for message content\n");
+            return ERR_PTR(-ENOMEM);
+        }
+    }
+
+    memcpy(new_msg->message, data, size);  // Copia o conteúdo da mensagem para a estrutura
+    new_msg->message[size] = '\0';
+    return new_msg;
+}
+
+// Função para adicionar uma mensagem ao anel de um processo (sem alocação)
+// Chamada dentro de rcu_read_lock(); data já está em memória do kernel.
+static int ring_add_message_to_process(struct process_s *proc, const char *data, short size, int policy) {
+    int ret;
+
+    spin_lock(&proc->lock);
+    if (proc->dead) {                       // Desregistrado enquanto a mensagem era preparada
+        spin_unlock(&proc->lock);
+        return -EINVAL;
+    }
+    if (size > proc->ring_slot_size - sizeof(struct mqueue_ring_slot) - 1) {
+        spin_unlock(&proc->lock);           // max_msg_size aumentou depois do registro: não cabe no slot
+        return -EMSGSIZE;
+    }
+    ret = ring_push(proc, data, size, policy);  // Contabiliza enfileiramento e descarte
+    spin_unlock(&proc->lock);
+    if (ret) {                              // Anel cheio e a política (ou o mapeamento) não deixa descartar
+        return ret;
+    }
+    wake_up_interruptible(&proc->wq);       // Acorda o leitor bloqueado e o poll
+    return 0;
+}
+
+// Função para adicionar uma mensagem à lista de mensagens de um processo
+// Chamada dentro de rcu_read_lock(); só toma o lock do processo de destino.
+// A fila está cheia quando passa de max_messages, da cota de bytes do processo ou
+// do orçamento global; com MQUEUE_OVERFLOW_DROP_OLDEST saem as mais antigas da
+// prioridade mais baixa até a nova caber. Mensagens mais urgentes que a nova nunca
+// são descartadas por ela: se só restam essas, a descartada é a nova.
+// Retorna 0 ou o resultado de queue_full().
+static int list_add_message_to_process(struct process_s *proc, struct message_s *new_msg, int policy) {
+    struct mq_instance *inst = proc->inst;
+    LIST_HEAD(evicted);                     // Mensagens descartadas, liberadas fora do lock
+    unsigned long budget = READ_ONCE(inst->max_total_bytes);
+    unsigned long quota;
+    int ret = 0;
+
+    spin_lock(&proc->lock);
+    if (proc->dead) {                       // Desregistrado enquanto a mensagem era preparada
+        spin_unlock(&proc->lock);
+        return -EINVAL;
+    }
+
+    quota = proc->quota_bytes;
+    if ((quota && new_msg->size > quota) ||
+        (budget && new_msg->size > budget)) {
+        note_drop(proc, new_msg->size, false);  // Nunca caberia: esperar ou descartar as outras não adianta
+        spin_unlock(&proc->lock);
+        return -ENOBUFS;
+    }
+
+    // O orçamento global só é cobrado depois que a fila tem espaço; se ele estiver
+    // esgotado por outras filas, descartar daqui também devolve bytes a ele
+    while (!list_has_room(proc, new_msg->size) || !charge_bytes(inst, new_msg->size)) {
+        struct message_s *oldest_msg;
+        unsigned int lowest;
+
+        if (policy != MQUEUE_OVERFLOW_DROP_OLDEST || proc->queue.count == 0) {
+            ret = queue_full(proc, new_msg->size, policy);
+            break;
+        }
+        lowest = mq_pq_victim_level(&proc->queue, new_msg->level);
+        if (lowest == MQ_LEVEL_NONE) {      // A nova é a menos urgente da fila
+            note_drop(proc, new_msg->size, false);
+            ret = -ENOBUFS;
+            break;
+        }
+        // Remove a mensagem mais antiga da prioridade mais baixa
+        oldest_msg = list_first_entry(&proc->queue.lists[lowest], struct message_s, link);
+        list_unqueue(proc, oldest_msg);
+        list_add_tail(&oldest_msg->link, &evicted);
+        note_drop(proc, oldest_msg->size, true);
+    }
+
+    if (!ret) {
+        mq_pq_push(&proc->queue, &new_msg->link, new_msg->level, new_msg->size);  // Bytes já cobrados do orçamento global
+        note_enqueue(proc, new_msg->size);
+    }
+    spin_unlock(&proc->lock);
+
+    if (!ret) {
+        wake_up_interruptible(&proc->wq);   // Acorda o leitor bloqueado e o poll
+    }
+    if (!list_empty(&evicted)) {
+        free_message_list(&evicted);        // Libera fora do lock
+        wake_writers(inst);                 // Os bytes devolvidos podem servir a outra fila
+    }
+    return ret;
+}
+
+// Envia data (size bytes, já em memória do kernel) ao processo name ou, se name
+// for NULL, ao processo handle. A mensagem é preparada antes da seção RCU.
+// prio (0 a MQUEUE_PRIO_MAX - 1) só vale no modo lista; o anel é FIFO.
+// Com a fila cheia vale a política do destino; MQUEUE_OVERFLOW_BLOCK dorme até
+// haver espaço, ou vira MQUEUE_OVERFLOW_REJECT se nonblock.
+static int send_message(struct mq_instance *inst, const char *name, int handle, const char *data, size_t size,
+                        unsigned int prio, bool nonblock) {
+    struct message_s *msg = NULL;
+    struct process_s *proc;
+    int ret;
+
+    if (queue_mode == QUEUE_MODE_LIST) {
+        msg = alloc_message(inst, data, size);  // kmalloc pode dormir
+        if (IS_ERR(msg)) {
+            return PTR_ERR(msg);
+        }
+        msg->level = mq_prio_level(prio);
+    }
+
+    for (;;) {
+        int policy;
+
+        rcu_read_lock();
+        proc = name ? find_process_rcu(inst, name) : find_process_handle_rcu(inst, handle);
+        if (!proc) {
+            rcu_read_unlock();
+            ret = -ENOENT;
+            break;
+        }
+        policy = READ_ONCE(proc->policy);
+        if (policy == MQUEUE_OVERFLOW_BLOCK && nonblock) {
+            policy = MQUEUE_OVERFLOW_REJECT;
+        }
+        if (msg) {
+            ret = list_add_message_to_process(proc, msg, policy);  // Adiciona a mensagem à lista do processo
+        } else {
+            ret = ring_add_message_to_process(proc, data, size, policy);
+        }
+        if (ret != QUEUE_FULL_WAIT) {
+            rcu_read_unlock();
+            break;
+        }
+
+        // Fila cheia com MQUEUE_OVERFLOW_BLOCK: espera fora do RCU segurando uma referência
+        if (!refcount_inc_not_zero(&proc->refs)) {
+            rcu_read_unlock();
+            ret = -ENOENT;
+            break;
+        }
+        rcu_read_unlock();
+        ret = wait_event_interruptible(inst->space_wq, queue_writable(proc, size));
+        process_put(proc);
+        if (ret) {
+            ret = -ERESTARTSYS;          // Interrompido por sinal; a mensagem não foi enviada
+            break;
+        }
+    }
+
+    if (ret < 0 && msg) {
+        free_message(msg);
+    }
+    return ret;
+}
+
+// Publica data num tópico. Modo lista: o conteúdo é copiado uma vez e cada assinante
+// recebe só um cabeçalho apontando para ele. Modo anel: o conteúdo é copiado no anel
+// de cada assinante. Retorna quantos assinantes receberam a mensagem.
+static int publish_message(struct mq_instance *inst, const char *name, const char *data, size_t size) {
+    struct shared_payload *payload = NULL;
+    struct subscription_s *sub;
+    struct topic_s *topic;
+    int delivered = 0;
+
+    if (size > READ_ONCE(inst->max_msg_size)) {
+        note_oversize(inst, size);
+        return -EMSGSIZE;
+    }
+    if (queue_mode == QUEUE_MODE_LIST) {
+        payload = kmalloc(sizeof(*payload) + size + 1, GFP_KERNEL);
+        if (!payload) {
+            return -ENOMEM;
+        }
+        refcount_set(&payload->refs, 1);  // Referência do publicador até o fim do laço
+        payload->size = size;
+        memcpy(payload->data, data, size);
+        payload->data[size] = '\0';
+    }
+
+    rcu_read_lock();
+    topic = find_topic_rcu(inst, name);
+    if (topic) {
+        list_for_each_entry_rcu(sub, &topic->subs, topic_link) {
+            struct message_s *msg;
+            int ret;
+
+            if (!payload) {
+                ret = ring_add_message_to_process(sub->proc, data, size, sub->policy);
+            } else {
+                msg = kmem_cache_alloc(msg_cache, GFP_ATOMIC);  // Só o cabeçalho, dentro da seção RCU
+                if (!msg) {
+                    continue;
+                }
+                refcount_inc(&payload->refs);
+                msg->shared = payload;
+                msg->message = payload->data;
+                msg->size = payload->size;
+                msg->level = mq_prio_level(0);  // Publicações entram com a prioridade padrão
+                ret = list_add_message_to_process(sub->proc, msg, sub->policy);
+                if (ret < 0) {
+                    free_message(msg);
+                }
+            }
+            if (ret == 0) {
+                delivered++;
+            }
+        }
+    }
+    rcu_read_unlock();
+
+    if (payload) {
+        payload_put(payload);
+    }
+    return topic ? delivered : -ENOENT;
+}
+
+// Retira a próxima mensagem de proc (a mais antiga da prioridade mais alta) e copia
+// para buf (capacidade cap); a prioridade dela vai para *prio.
+// Retorna o tamanho, -EAGAIN com a fila vazia ou -EMSGSIZE se não couber (a
+// mensagem fica na fila). bounce comporta uma mensagem de proc: no modo anel o slot
+// é copiado sob o lock, porque pode ser sobrescrito logo depois.
+static int recv_message(struct process_s *proc, char __user *buf, size_t cap, char *bounce, unsigned int *prio) {
+    struct message_s *msg = NULL;
+    int size;
+
+    spin_lock(&proc->lock);
+    if (proc->dead || proc->mapped) {    // Desregistrado ou lido direto do anel mapeado
+        spin_unlock(&proc->lock);
+        return proc->dead ? -ENOENT : -EBUSY;
+    }
+    if (process_msg_count(proc) == 0) {
+        spin_unlock(&proc->lock);
+        return -EAGAIN;
+    }
+
+    if (proc->ring) {
+        unsigned int tail = ring_tail(proc);
+        struct mqueue_ring_slot *slot = ring_slot_at(proc, tail);
+
+        size = ring_slot_len(proc, slot);  // O cabeçalho do slot é gravável pelo mmap
+        if (size > cap) {
+            spin_unlock(&proc->lock);
+            return -EMSGSIZE;
+        }
+        memcpy(bounce, slot->data, size);
+        smp_store_release(&proc->ring->tail, tail + 1);
+        note_dequeue(proc, size);
+        *prio = 0;
+    } else {
+        msg = list_peek(proc);
+        size = msg->size;
+        if (size > cap) {
+            spin_unlock(&proc->lock);
+            return -EMSGSIZE;
+        }
+        list_unqueue(proc, msg);
+        note_dequeue(proc, size);
+        *prio = mq_prio_level(msg->level);  // A conversão é simétrica
+    }
+    spin_unlock(&proc->lock);
+    wake_writers(proc->inst);
+
+    if (copy_to_user(buf, msg ? msg->message : bounce, size)) {
+        size = -EFAULT;
+    }
+    if (msg) {
+        free_message(msg);
+    }
+    return size;
+}
+
+// Nome lido de um comando: nomes de MQUEUE_NAME_LEN bytes ou mais não cabem no '\0' final
+static bool name_ok(const char *name) {
+    return strlen(name) < MQUEUE_NAME_LEN;
+}
+
+// Processa um comando de texto já copiado para o kernel (buffer termina em '\0')
+static ssize_t dev_write_command(struct file *filep, char *buffer, size_t len, int msg_size) {
+    struct mq_client *client = filep->private_data;
+    struct mq_instance *inst = client->inst;
+    char command[16], target_process[MQUEUE_NAME_LEN + 1], read_process[MQUEUE_NAME_LEN + 1];
+    struct process_s *proc;
+    struct process_s *own = READ_ONCE(client->own);  // Processo registrado por este arquivo
+    int num_messages = 1;  // Número de mensagens a ser lido, por padrão 1
+    int fields;
+
+    if (sscanf(buffer, "/reg " NAME_SCAN, target_process) == 1) {  // Comando para registrar um processo
+        int ret;
+
+        if (!name_ok(target_process)) {
+            return -ENAMETOOLONG;
+        }
+        ret = register_process(client, target_process, current->pid);  // Registra o processo e o vincula ao arquivo
+        return ret < 0 ? ret : len;
+    }
+    
+    if (sscanf(buffer, "/unreg " NAME_SCAN, target_process) == 1) {  // Comando para desregistrar um processo
+        if (own && strcmp(own->name, target_process) == 0) {
+            unregister_own(own);                              // O próprio processo: sem busca
+        } else {
+            unregister_process(inst, target_process, current->pid);    // Desregistra o processo
+        }
+        return len;
+    }
+
+    fields = sscanf(buffer, "/sub " NAME_SCAN " %15s", target_process, command);
+    if (fields >= 1) {  // Assina um tópico: /sub tópico [oldest|new]
+        int policy = MQUEUE_OVERFLOW_DROP_OLDEST;
+        int ret;
+
+        if (!name_ok(target_process)) {
+            return -ENAMETOOLONG;
+        }
+        if (!own) {
+            return -EINVAL;              // Só um processo registrado pode assinar
+        }
+        if (fields == 2 && strcmp(command, "new") == 0) {
+            policy = MQUEUE_OVERFLOW_DROP_NEW;
+        }
+        ret = subscribe_topic(own, target_process, policy);
+        return ret < 0 ? ret : len;
+    }
+
+    if (sscanf(buffer, "/unsub " NAME_SCAN, target_process) == 1) {  // Cancela a assinatura de um tópico
+        int ret = own ? unsubscribe_topic(own, target_process) : -EINVAL;
+        return ret < 0 ? ret : len;
+    }
+
+    fields = 0;
+    if (sscanf(buffer, "/pub " NAME_SCAN "%n", target_process, &fields) == 1) {  // Publica num tópico: /pub tópico mensagem
+        char *message = buffer + fields;  // Conteúdo depois do tópico, na cópia do comando
+        size_t size;
+        int ret;
+
+        if (*message != ' ') {
+            mq_dbg("Error: empty message for topic %s\n", target_process);
+            return -EINVAL;
+        }
+        message++;
+        size = strlen(message);
+        if (size > msg_size) {
+            note_oversize(inst, size);
+            return -EINVAL;
+        }
 
-// Informações do módulo
-MODULE_LICENSE("GPL");           
-MODULE_AUTHOR("Guilherme Martins Specht");
-MODULE_DESCRIPTION("Desenvolvimento do trabalho TP2 de CSO."); 
-MODULE_VERSION("0.1.0");         
+        ret = publish_message(inst, target_process, message, size);
+        if (ret < 0) {
+            mq_dbg("Error: topic %s not found\n", target_process);
+            return ret == -ENOENT ? -EINVAL : ret;
+        }
+        return len;
+    }
 
-// Variáveis globais para o número principal e a classe do dispositivo
-static int majorNumber;          // Número principal do dispositivo
-static struct class *mqueueClass = NULL;  // Classe do dispositivo
-static struct device *mqueueDevice = NULL;  // Dispositivo do kernel
+    if (sscanf(buffer, "/read " NAME_SCAN " %d", read_process, &num_messages) >= 1) {  // Comando para ler mensagens
+        LIST_HEAD(consumed);             // Mensagens retiradas da fila, liberadas fora do lock
+        struct message_s *msg;
+        int available_messages;
 
-// Parâmetros configuráveis pelo usuário
-static int max_messages = 5;     // Número máximo de mensagens por processo
-static int max_msg_size = 250;   // Tamanho máximo de cada mensagem
+        rcu_read_lock();
+        if (own && !own->dead && strcmp(own->name, read_process) == 0) {
+            proc = own;                  // O próprio processo: o arquivo já tem a referência
+        } else {
+            proc = find_process_rcu(inst, read_process);  // Encontra o processo correspondente
+        }
+        if (!proc) {
+            rcu_read_unlock();
+            // Se o processo não for encontrado
+            mq_dbg("Error: process %s not found\n", read_process);
+            return -EINVAL;
+        }
 
-// Define os parâmetros que podem ser configurados pelo usuário no momento da carga do módulo
-module_param(max_messages, int, 0644);  // Parâmetro de número máximo de mensagens
-MODULE_PARM_DESC(max_messages, "Número máximo de mensagens por processo"); // Descrição do parâmetro
+        spin_lock(&proc->lock);
+        if (proc->mapped) {             // O consumidor lê direto do anel mapeado
+            spin_unlock(&proc->lock);
+            rcu_read_unlock();
+            return -EBUSY;
+        }
+        available_messages = process_msg_count(proc);  // Verifica se há mensagens suficientes disponíveis
 
-module_param(max_msg_size, int, 0644);  // Parâmetro de tamanho máximo de mensagens
-MODULE_PARM_DESC(max_msg_size, "Tamanho máximo de cada mensagem (bytes)"); // Descrição do parâmetro
+        if (available_messages == 0) {  // Nenhuma mensagem disponível
+            spin_unlock(&proc->lock);
+            rcu_read_unlock();
+            mq_dbg("Error: process %s has no messages\n", read_process);
+            return -EINVAL;
+        }
 
-// Definir a estrutura para armazenar as mensagens
-struct message_s {
-    struct list_head link;       // Estrutura de lista ligada para conectar as mensagens
-    char *message;               // Ponteiro para o conteúdo da mensagem (alocado dinamicamente)
-    short size;                  // Tamanho da mensagem
-};
+        if (available_messages < num_messages) {  // Número insuficiente de mensagens
+            spin_unlock(&proc->lock);
+            rcu_read_unlock();
+            mq_dbg("Error: process %s has only %d messages\n", read_process, available_messages);
+            return -EINVAL;
+        }
 
-// Definir a estrutura para armazenar processos
-struct process_s {
-    struct list_head link;       // Estrutura de lista ligada para conectar os processos
-    pid_t pid;                   // PID do processo
-    char *name;                  // Nome do processo (alocado dinamicamente)
-    struct list_head msg_list;   // Lista de mensagens associadas a este processo
-    int msg_count;               // Contador de mensagens na fila
-};
+        if (proc->ring) {               // Modo anel: lê no lugar e libera o slot avançando o tail
+            unsigned int tail = ring_tail(proc);
 
-// Lista de processos registrados
-struct list_head process_list;   // Lista de processos que foram registrados
+            while (num_messages-- > 0) {
+                struct mqueue_ring_slot *slot = ring_slot_at(proc, tail);
+                unsigned int size = ring_slot_len(proc, slot);
 
-// Função para registrar um processo e inicializar sua lista de mensagens
-int register_process(char *name, pid_t pid) {
-    struct process_s *new_proc = kmalloc(sizeof(struct process_s), GFP_KERNEL);  // Aloca memória para um novo processo
-    
-    if (!new_proc) {              // Verifica se a alocação foi bem-sucedida
-        printk(KERN_INFO "Memory allocation failed for process registration\n");
-        return -ENOMEM;
+                mq_dbg("process %s read a message of %u bytes\n", read_process, size);
+                tail++;
+                smp_store_release(&proc->ring->tail, tail);
+                note_dequeue(proc, size);
+            }
+            spin_unlock(&proc->lock);
+            rcu_read_unlock();
+            wake_writers(inst);
+            return len;
+        }
+
+        // Retira as mensagens solicitadas da lista do processo, por prioridade
+        while (num_messages-- > 0) {
+            msg = list_peek(proc);
+            list_unqueue(proc, msg);
+            list_add_tail(&msg->link, &consumed);
+            note_dequeue(proc, msg->size);
+        }
+        spin_unlock(&proc->lock);
+        rcu_read_unlock();
+        wake_writers(inst);
+
+        // Só o tamanho vai para o log, e só com debug: o conteúdo das mensagens nunca é impresso
+        list_for_each_entry(msg, &consumed, link) {
+            mq_dbg("process %s read a message of %d bytes\n", read_process, msg->size);
+        }
+        free_message_list(&consumed);
+        return len;
     }
 
-    new_proc->name = kmalloc(max_msg_size, GFP_KERNEL);  // Aloca memória para o nome do processo
-    if (!new_proc->name) {        // Verifica se a alocação do nome foi bem-sucedida
-        kfree(new_proc);          // Libera a memória do processo se a alocação falhar
-        printk(KERN_INFO "Memory allocation failed for process name\n");
-        return -ENOMEM;
+    if (sscanf(buffer, "/" NAME_SCAN, target_process) == 1) {  // Envio de mensagem a um processo
+        char *message = strchr(buffer, ' ');  // Obtém o conteúdo da mensagem
+        size_t size;
+        int ret;
+
+        if (!message) {
+            mq_dbg("Error: empty message for process %s\n", target_process);
+            return -EINVAL;
+        }
+        message++;
+
+        size = strlen(message);
+        if (size > msg_size) {
+            note_oversize(inst, size);
+            return -EINVAL;
+        }
+
+        // message está na cópia do comando, em memória do kernel: o anel pode ser preenchido sob o spinlock
+        ret = send_message(inst, target_process, 0, message, size, 0, filep->f_flags & O_NONBLOCK);
+        if (ret == -ENOENT) {
+            mq_dbg("Error: process %s not found\n", target_process);  // Processo não encontrado
+            return -EINVAL;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        return len;
     }
 
-    strcpy(new_proc->name, name);  // Copia o nome do processo para a estrutura
-    new_proc->pid = pid;           // Armazena o PID do processo
-    new_proc->msg_count = 0;       // Inicializa o contador de mensagens
-    INIT_LIST_HEAD(&new_proc->msg_list);  // Inicializa a lista de mensagens do processo
-    list_add_tail(&new_proc->link, &process_list);  // Adiciona o processo à lista de processos
-    printk(KERN_INFO "Process %s (PID: %d) registered successfully\n", name, pid);
-    
-    return 0;
+    mq_dbg("Invalid command\n");  // Comando inválido
+    return -EINVAL;
 }
 
-// Função para desregistrar um processo, removendo suas mensagens e liberando memória
-int unregister_process(char *name, pid_t pid) {
+// Função de escrita no dispositivo, que processa comandos como registro/desregistro e envio de mensagens.
+// O comando é copiado inteiro para um buffer do kernel, limitado pelo max_msg_size da instância.
+static ssize_t dev_write(struct file *filep, const char __user *buffer, size_t len, loff_t *offset) {
+    struct mq_instance *inst = ((struct mq_client *)filep->private_data)->inst;
+    int msg_size = READ_ONCE(inst->max_msg_size);  // Um valor só durante todo o comando
+    char *command;
+    ssize_t ret;
+
+    if (len > (size_t)msg_size + CMD_OVERHEAD) {
+        note_oversize(inst, len);
+        return -EINVAL;
+    }
+    command = memdup_user_nul(buffer, len);
+    if (IS_ERR(command)) {
+        return PTR_ERR(command);
+    }
+    ret = dev_write_command(filep, command, len, msg_size);
+    kfree(command);
+    return ret;
+}
+
+// REGISTER e LOOKUP: traduzem um nome em handle
+static long ioctl_register(struct mq_client *client, unsigned int cmd, struct mqueue_reg __user *ureg) {
+    struct mqueue_reg reg;
     struct process_s *proc;
-    struct message_s *msg, *tmp;
-    
-    list_for_each_entry(proc, &process_list, link) {  // Percorre a lista de processos registrados
-        if (strcmp(proc->name, name) == 0 && proc->pid == pid) {  // Verifica se o nome e o PID correspondem
-            // Remove todas as mensagens associadas ao processo
-            list_for_each_entry_safe(msg, tmp, &proc->msg_list, link) {
-                list_del(&msg->link);   // Remove a mensagem da lista
-                kfree(msg->message);    // Libera a memória da mensagem
-                kfree(msg);             // Libera a estrutura da mensagem
+    int ret;
+
+    if (copy_from_user(&reg, ureg, sizeof(reg))) {
+        return -EFAULT;
+    }
+    if (!reg.name[0] || strnlen(reg.name, MQUEUE_NAME_LEN) == MQUEUE_NAME_LEN) {
+        return -EINVAL;
+    }
+
+    if (cmd == MQUEUE_IOC_REGISTER) {
+        ret = register_process(client, reg.name, current->pid);
+    } else {
+        rcu_read_lock();
+        proc = find_process_rcu(client->inst, reg.name);
+        ret = proc ? proc->handle : -ENOENT;
+        rcu_read_unlock();
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    reg.handle = ret;
+    return copy_to_user(ureg, &reg, sizeof(reg)) ? -EFAULT : 0;
+}
+
+// SEND_BATCH e RECV_BATCH: até MQUEUE_BATCH_MAX mensagens por syscall, com status
+// individual. Um erro numa mensagem não interrompe o lote; só falhas de cópia dos
+// descritores (EFAULT) ou, no RECV, a fila vazia ou uma mensagem que não cabe.
+static long ioctl_batch(struct file *filep, unsigned int cmd, struct mqueue_batch __user *ubatch) {
+    struct mq_client *client = filep->private_data;
+    struct mq_instance *inst = client->inst;
+    struct process_s *own = READ_ONCE(client->own);
+    int msg_size = READ_ONCE(inst->max_msg_size);
+    bool send = cmd == MQUEUE_IOC_SEND_BATCH;
+    struct process_s *proc = NULL;
+    struct mqueue_batch batch;
+    struct mqueue_msg __user *umsgs;
+    struct mqueue_msg m;
+    char *bounce;
+    long ret = 0;
+    u32 done;
+
+    if (copy_from_user(&batch, ubatch, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count > MQUEUE_BATCH_MAX) {
+        return -EINVAL;
+    }
+    umsgs = u64_to_user_ptr(batch.msgs);
+
+    if (!send && own && (batch.handle == 0 || batch.handle == own->handle)) {
+        proc = own;                      // Fila do próprio arquivo: sem busca
+        refcount_inc(&proc->refs);
+    } else if (!send) {                  // A fila de origem precisa sobreviver às cópias fora do RCU
+        rcu_read_lock();
+        proc = find_process_handle_rcu(inst, batch.handle);
+        if (proc && (proc->pid != current->pid || !refcount_inc_not_zero(&proc->refs))) {
+            ret = proc->pid != current->pid ? -EPERM : -ENOENT;
+            proc = NULL;
+        } else if (!proc) {
+            ret = -ENOENT;
+        }
+        rcu_read_unlock();
+        if (!proc) {
+            return ret;
+        }
+    }
+
+    // Um buffer por lote, não por mensagem. Os slots do anel têm o max_msg_size do registro.
+    bounce = kmalloc(proc && proc->ring ? proc->ring_slot_size : msg_size + 1, GFP_KERNEL);
+    if (!bounce) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (done = 0; done < batch.count; done++) {
+        if (copy_from_user(&m, &umsgs[done], sizeof(m))) {
+            ret = -EFAULT;
+            break;
+        }
+
+        if (send) {
+            if (m.len > msg_size) {
+                note_oversize(inst, m.len);
+                m.status = -EMSGSIZE;
+            } else if (m.priority >= MQUEUE_PRIO_MAX) {
+                m.status = -EINVAL;
+            } else if (copy_from_user(bounce, u64_to_user_ptr(m.data), m.len)) {
+                m.status = -EFAULT;
+            } else {
+                m.status = min(send_message(inst, NULL, m.handle, bounce, m.len, m.priority, filep->f_flags & O_NONBLOCK), 0);
             }
-            list_del(&proc->link);      // Remove o processo da lista de processos
-            kfree(proc->name);          // Libera a memória do nome do processo
-            kfree(proc);                // Libera a estrutura do processo
-            printk(KERN_INFO "Process %s (PID: %d) unregistered and messages discarded\n", name, pid);
-            return 0;
+        } else {
+            unsigned int prio = 0;
+            int size = recv_message(proc, u64_to_user_ptr(m.data), m.len, bounce, &prio);
+
+            if (size == -EAGAIN) {       // Fila vazia: o lote termina aqui
+                break;
+            }
+            m.status = min(size, 0);
+            if (size >= 0) {
+                m.len = size;
+                m.priority = prio;
+            }
+        }
+
+        if (copy_to_user(&umsgs[done], &m, sizeof(m))) {
+            ret = -EFAULT;
+            break;
+        }
+        if (!send && m.status == -EMSGSIZE) {  // A mensagem continua na fila; a próxima tentativa a veria de novo
+            done++;
+            break;
         }
     }
-    
-    printk(KERN_INFO "Process %s (PID: %d) not found for unregistration\n", name, pid);  // Caso o processo não seja encontrado
-    return -EINVAL;
+    kfree(bounce);
+
+    if (!ret && !send && done == 0) {
+        ret = -EAGAIN;                   // Nada para ler, como o read não bloqueante
+    }
+    if (put_user(done, &ubatch->done)) {
+        ret = -EFAULT;
+    }
+out:
+    if (proc) {
+        process_put(proc);
+    }
+    return ret;
 }
 
-// Função para adicionar uma mensagem à lista de mensagens de um processo
-static int list_add_message_to_process(struct process_s *proc, char *data) {
-    if (proc->msg_count >= max_messages) {  // Verifica se o número de mensagens excede o limite configurado
-        printk(KERN_INFO "Process %s message queue is full. Discarding oldest message.\n", proc->name);
-        // Remove a mensagem mais antiga (primeira da lista)
-        struct message_s *oldest_msg = list_first_entry(&proc->msg_list, struct message_s, link);
-        list_del(&oldest_msg->link);        // Remove a mensagem da lista
-        kfree(oldest_msg->message);         // Libera a memória da mensagem
-        kfree(oldest_msg);                  // Libera a estrutura da mensagem
-        proc->msg_count--;                  // Decrementa o contador de mensagens
+// SUBSCRIBE e UNSUBSCRIBE: assinaturas do processo registrado por este arquivo
+static long ioctl_subscribe(struct process_s *own, unsigned int cmd, struct mqueue_sub __user *usub) {
+    struct mqueue_sub sub;
+
+    if (!own) {
+        return -EINVAL;
+    }
+    if (copy_from_user(&sub, usub, sizeof(sub))) {
+        return -EFAULT;
+    }
+    if (!sub.topic[0] || strnlen(sub.topic, MQUEUE_NAME_LEN) == MQUEUE_NAME_LEN) {
+        return -EINVAL;
     }
+    if (cmd == MQUEUE_IOC_SUBSCRIBE) {
+        return subscribe_topic(own, sub.topic, sub.policy);
+    }
+    return unsubscribe_topic(own, sub.topic);
+}
 
-    // Verifica se o tamanho da mensagem excede o tamanho máximo permitido
-    if (strlen(data) > max_msg_size) {
-        printk(KERN_INFO "Message exceeds the maximum allowed size for process %s. Discarding.\n", proc->name);
+// PUBLISH: o conteúdo é copiado do usuário uma vez só
+static long ioctl_publish(struct mq_instance *inst, struct mqueue_pub __user *upub) {
+    struct mqueue_pub pub;
+    char *payload;
+    int ret;
+
+    if (copy_from_user(&pub, upub, sizeof(pub))) {
+        return -EFAULT;
+    }
+    if (!pub.topic[0] || strnlen(pub.topic, MQUEUE_NAME_LEN) == MQUEUE_NAME_LEN) {
         return -EINVAL;
     }
+    if (pub.len > READ_ONCE(inst->max_msg_size)) {
+        note_oversize(inst, pub.len);
+        return -EMSGSIZE;
+    }
 
-    struct message_s *new_msg = kmalloc(sizeof(struct message_s), GFP_KERNEL);  // Aloca memória para uma nova mensagem
-    if (!new_msg) {                        // Verifica se a alocação foi bem-sucedida
-        printk(KERN_INFO "Memory allocation failed for message\n");
+    payload = kmalloc(pub.len + 1, GFP_KERNEL);
+    if (!payload) {
         return -ENOMEM;
     }
+    if (copy_from_user(payload, u64_to_user_ptr(pub.data), pub.len)) {
+        kfree(payload);
+        return -EFAULT;
+    }
+    payload[pub.len] = '\0';
 
-    new_msg->message = kmalloc(max_msg_size, GFP_KERNEL);  // Aloca memória para o conteúdo da mensagem
-    if (!new_msg->message) {          // Verifica se a alocação foi bem-sucedida
-        kfree(new_msg);               // Libera a estrutura da mensagem se a alocação falhar
-        printk(KERN_INFO "Memory allocation failed for message content\n");
-        return -ENOMEM;
+    ret = publish_message(inst, pub.topic, payload, pub.len);
+    kfree(payload);
+    if (ret < 0) {
+        return ret;
     }
+    return put_user(ret, &upub->delivered) ? -EFAULT : 0;
+}
 
-    strcpy(new_msg->message, data);  // Copia o conteúdo da mensagem para a estrutura
-    new_msg->size = strlen(data);    // Armazena o tamanho da mensagem
-    
-    list_add_tail(&(new_msg->link), &proc->msg_list);  // Adiciona a mensagem à lista do processo
-    proc->msg_count++;              // Incrementa o contador de mensagens
-    
-    printk(KERN_INFO "Message added to process %s: %s\n", proc->name, data);
+// SET_LIMITS: cota de bytes e política de fila cheia do processo deste arquivo;
+// devolve os descartes e bloqueios acumulados na fila
+static long ioctl_limits(struct process_s *own, struct mqueue_limits __user *ulim) {
+    struct mqueue_limits lim;
+
+    if (!own) {
+        return -EINVAL;
+    }
+    if (copy_from_user(&lim, ulim, sizeof(lim))) {
+        return -EFAULT;
+    }
+    // Cota que não cabe em unsigned long (só acontece em 32 bits) é recusada, não truncada
+    if (lim.policy > MQUEUE_OVERFLOW_BLOCK || (unsigned long)lim.quota_bytes != lim.quota_bytes) {
+        return -EINVAL;
+    }
+
+    spin_lock(&own->lock);
+    WRITE_ONCE(own->quota_bytes, lim.quota_bytes);
+    WRITE_ONCE(own->policy, lim.policy);
+    lim.dropped = own->dropped;
+    lim.blocked = own->blocked;
+    spin_unlock(&own->lock);
+    wake_writers(own->inst);             // Escritores bloqueados reavaliam a cota e a política
+
+    return copy_to_user(ulim, &lim, sizeof(lim)) ? -EFAULT : 0;
+}
+
+// /sys/kernel/debug/mqueue/<dispositivo>/stats: soma dos contadores de todas as CPUs
+static int stats_show(struct seq_file *m, void *v) {
+    struct mq_instance *inst = m->private;
+    struct mqueue_stats sum = {};
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct mqueue_stats *s = per_cpu_ptr(inst->stats, cpu);
+
+        sum.enqueued += READ_ONCE(s->enqueued);
+        sum.dequeued += READ_ONCE(s->dequeued);
+        sum.dropped += READ_ONCE(s->dropped);
+        sum.rejected_oversize += READ_ONCE(s->rejected_oversize);
+        sum.bytes_in += READ_ONCE(s->bytes_in);
+        sum.bytes_out += READ_ONCE(s->bytes_out);
+        sum.rejected_full += READ_ONCE(s->rejected_full);
+        sum.blocked += READ_ONCE(s->blocked);
+    }
+    seq_printf(m, "enqueued %lu\n", sum.enqueued);
+    seq_printf(m, "dequeued %lu\n", sum.dequeued);
+    seq_printf(m, "dropped %lu\n", sum.dropped);
+    seq_printf(m, "rejected_oversize %lu\n", sum.rejected_oversize);
+    seq_printf(m, "bytes_in %lu\n", sum.bytes_in);
+    seq_printf(m, "bytes_out %lu\n", sum.bytes_out);
+    seq_printf(m, "rejected_full %lu\n", sum.rejected_full);
+    seq_printf(m, "blocked %lu\n", sum.blocked);
+    seq_printf(m, "queued_bytes %ld\n", atomic_long_read(&inst->queued_bytes));
+    seq_printf(m, "max_total_bytes %lu\n", READ_ONCE(inst->max_total_bytes));
     return 0;
 }
+DEFINE_SHOW_ATTRIBUTE(stats);
 
-// Função de escrita no dispositivo, que processa comandos como registro/desregistro e envio de mensagens
-static ssize_t dev_write(struct file *filep, const char *buffer, size_t len, loff_t *offset) {
-    char command[max_msg_size], target_process[max_msg_size], read_process[max_msg_size];
+// /sys/kernel/debug/mqueue/<dispositivo>/endpoints: uma linha por processo registrado
+static int endpoints_show(struct seq_file *m, void *v) {
+    struct mq_instance *inst = m->private;
     struct process_s *proc;
-    int num_messages = 1;  // Número de mensagens a ser lido, por padrão 1
+    int bkt;
 
-    if (sscanf(buffer, "/reg %s", target_process) == 1) {  // Comando para registrar um processo
-        register_process(target_process, current->pid);    // Registra o processo
-        return len;
+    seq_puts(m, "handle pid depth hwm bytes quota policy dropped blocked name\n");
+    rcu_read_lock();
+    hash_for_each_rcu(inst->process_table, bkt, proc, hnode) {
+        unsigned int depth, hwm;
+        unsigned long bytes, quota, dropped, blocked;
+        int policy;
+
+        spin_lock(&proc->lock);
+        depth = process_msg_count(proc);
+        hwm = proc->depth_hwm;
+        bytes = proc->queue.bytes;
+        quota = proc->quota_bytes;
+        policy = proc->policy;
+        dropped = proc->dropped;
+        blocked = proc->blocked;
+        spin_unlock(&proc->lock);
+        seq_printf(m, "%d %d %u %u %lu %lu %d %lu %lu %s\n", proc->handle, proc->pid, depth, hwm,
+                   bytes, quota, policy, dropped, blocked, proc->name);
     }
-    
-    if (sscanf(buffer, "/unreg %s", target_process) == 1) {  // Comando para desregistrar um processo
-        unregister_process(target_process, current->pid);    // Desregistra o processo
-        return len;
+    rcu_read_unlock();
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(endpoints);
+
+// Limites de cada instância em /sys/class/mqueue_class/<dispositivo>/. Valem para os
+// envios seguintes; a geometria de um anel e a cota e política de um processo são
+// fixadas no registro dele.
+#define MQ_LIMIT_ATTR(field, type, fmt, parse, minv, maxv)                              \
+static ssize_t field##_show(struct device *dev, struct device_attribute *attr, char *buf) {   \
+    struct mq_instance *inst = dev_get_drvdata(dev);                                    \
+                                                                                        \
+    return sprintf(buf, fmt "\n", READ_ONCE(inst->field));                              \
+}                                                                                       \
+static ssize_t field##_store(struct device *dev, struct device_attribute *attr,        \
+                             const char *buf, size_t count) {                           \
+    struct mq_instance *inst = dev_get_drvdata(dev);                                    \
+    type val;                                                                           \
+    int ret = parse(buf, 0, &val);                                                      \
+                                                                                        \
+    if (ret) {                                                                          \
+        return ret;                                                                     \
+    }                                                                                   \
+    if (val < (minv) || val > (maxv)) {                                                 \
+        return -EINVAL;                                                                 \
+    }                                                                                   \
+    WRITE_ONCE(inst->field, val);                                                       \
+    return count;                                                                       \
+}                                                                                       \
+static DEVICE_ATTR_RW(field)
+
+MQ_LIMIT_ATTR(max_messages, int, "%d", kstrtoint, 1, INT_MAX);
+MQ_LIMIT_ATTR(max_msg_size, int, "%d", kstrtoint, 1, MSG_SIZE_MAX);
+MQ_LIMIT_ATTR(max_total_bytes, unsigned long, "%lu", kstrtoul, 0, ULONG_MAX);
+MQ_LIMIT_ATTR(max_queue_bytes, unsigned long, "%lu", kstrtoul, 0, ULONG_MAX);
+MQ_LIMIT_ATTR(overflow_policy, int, "%d", kstrtoint, MQUEUE_OVERFLOW_DROP_OLDEST, MQUEUE_OVERFLOW_BLOCK);
+
+static struct attribute *mq_limit_attrs[] = {
+    &dev_attr_max_messages.attr,
+    &dev_attr_max_msg_size.attr,
+    &dev_attr_max_total_bytes.attr,
+    &dev_attr_max_queue_bytes.attr,
+    &dev_attr_overflow_policy.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(mq_limit);
+
+// Cria uma instância e o seu dispositivo /dev/<name>. Os limites vêm de req; campos
+// zero (ou req NULL) ficam com os parâmetros do módulo. Chamada com instance_lock.
+static struct mq_instance *instance_create(const char *name, const struct mqueue_instance *req) {
+    struct mq_instance *inst;
+    int ret;
+
+    inst = kzalloc(sizeof(*inst), GFP_KERNEL);
+    if (!inst) {
+        return ERR_PTR(-ENOMEM);
+    }
+    inst->stats = alloc_percpu(struct mqueue_stats);
+    if (!inst->stats) {
+        kfree(inst);
+        return ERR_PTR(-ENOMEM);
+    }
+    kref_init(&inst->ref);           // Referência da criação, solta em instance_destroy
+    hash_init(inst->process_table);
+    idr_init(&inst->process_idr);
+    mutex_init(&inst->registry_lock);
+    hash_init(inst->topic_table);
+    atomic_long_set(&inst->queued_bytes, 0);
+    init_waitqueue_head(&inst->space_wq);
+    inst->max_messages = req && req->max_messages ? req->max_messages : max_messages;
+    inst->max_msg_size = req && req->max_msg_size ? req->max_msg_size : max_msg_size;
+    inst->max_total_bytes = req && req->max_total_bytes ? req->max_total_bytes : max_total_bytes;
+    inst->max_queue_bytes = req && req->max_queue_bytes ? req->max_queue_bytes : max_queue_bytes;
+    inst->overflow_policy = req ? req->overflow_policy : overflow_policy;
+    strscpy(inst->name, name, sizeof(inst->name));
+
+    // Reserva o minor vazio: open só encontra a instância depois que ela está pronta
+    inst->minor = idr_alloc(&instance_idr, NULL, 0, MQUEUE_MAX_MINORS, GFP_KERNEL);
+    if (inst->minor < 0) {
+        ret = inst->minor;
+        goto err;
+    }
+    inst->device = device_create_with_groups(mqueueClass, NULL, MKDEV(majorNumber, inst->minor), inst,
+                                             mq_limit_groups, "%s", name);
+    if (IS_ERR(inst->device)) {
+        ret = PTR_ERR(inst->device);
+        idr_remove(&instance_idr, inst->minor);
+        goto err;
     }
 
-    if (sscanf(buffer, "/read %s %d", read_process, &num_messages) >= 1) {  // Comando para ler mensagens
-        list_for_each_entry(proc, &process_list, link) {  // Percorre a lista de processos
-            if (strcmp(proc->name, read_process) == 0) {  // Encontra o processo correspondente
-                int i = 0;
-                struct message_s *msg, *tmp;
+    // Estatísticas para depuração; falhar aqui não impede a instância de funcionar
+    inst->debug_dir = debugfs_create_dir(name, debug_dir);
+    debugfs_create_file("stats", 0444, inst->debug_dir, inst, &stats_fops);
+    debugfs_create_file("endpoints", 0444, inst->debug_dir, inst, &endpoints_fops);
 
-                // Verifica se há mensagens suficientes disponíveis
-                int available_messages = 0;
-                list_for_each_entry(msg, &proc->msg_list, link) {
-                    available_messages++;
-                }
+    idr_replace(&instance_idr, inst, inst->minor);
+    return inst;
 
-                if (available_messages == 0) {  // Nenhuma mensagem disponível
-                    printk(KERN_INFO "Error: process %s has no messages\n", read_process);
-                    return -EINVAL;
-                }
+err:
+    instance_put(inst);
+    return ERR_PTR(ret);
+}
 
-                if (available_messages < num_messages) {  // Número insuficiente de mensagens
-                    printk(KERN_INFO "Error: process %s has only %d messages\n", read_process, available_messages);
-                    return -EINVAL;
-                }
+// Remove o dispositivo e os arquivos de depuração. Arquivos do dispositivo já abertos
+// continuam funcionando; a memória fica até soltarem suas referências. Os do debugfs não
+// seguram referência: debugfs_remove_recursive espera as leituras em andamento e as
+// seguintes falham com EIO, então nenhuma usa inst depois daqui. Chamada com instance_lock.
+static void instance_destroy(struct mq_instance *inst) {
+    idr_remove(&instance_idr, inst->minor);  // Novos open falham com ENODEV
+    debugfs_remove_recursive(inst->debug_dir);
+    device_destroy(mqueueClass, MKDEV(majorNumber, inst->minor));
+    instance_put(inst);
+}
 
-                // Lê e remove as mensagens solicitadas da lista do processo
-                list_for_each_entry_safe(msg, tmp, &proc->msg_list, link) {
-                    if (i >= num_messages) break;
-                    printk(KERN_INFO "Process %s read message: %s\n", read_process, msg->message);
-                    list_del(&msg->link);        // Remove a mensagem da lista
-                    kfree(msg->message);         // Libera a memória da mensagem
-                    kfree(msg);                  // Libera a estrutura da mensagem
-                    i++;
-                }
-                return len;
-            }
-        }
+// Destrói todas as instâncias (saída do módulo ou falha na carga)
+static void instance_destroy_all(void) {
+    struct mq_instance *inst;
+    int id;
+
+    mutex_lock(&instance_lock);
+    idr_for_each_entry(&instance_idr, inst, id) {
+        instance_destroy(inst);
+    }
+    mutex_unlock(&instance_lock);
+}
+
+// CREATE_INSTANCE e DESTROY_INSTANCE: instâncias /dev/mqueue-<nome> sob demanda
+static long ioctl_instance(unsigned int cmd, struct mqueue_instance __user *uarg) {
+    char devname[sizeof(((struct mq_instance *)0)->name)];
+    struct mq_instance *inst, *found = NULL;
+    struct mqueue_instance req;
+    long ret = 0;
+    int id, i;
 
-        // Se o processo não for encontrado
-        printk(KERN_INFO "Error: process %s not found\n", read_process);
+    if (!capable(CAP_SYS_ADMIN)) {
+        return -EPERM;                   // Cria e remove nós em /dev
+    }
+    if (copy_from_user(&req, uarg, sizeof(req))) {
+        return -EFAULT;
+    }
+    if (!req.name[0] || strnlen(req.name, MQUEUE_NAME_LEN) == MQUEUE_NAME_LEN) {
         return -EINVAL;
     }
+    for (i = 0; req.name[i]; i++) {      // O nome vira nome de arquivo e de diretório
+        if (!isalnum(req.name[i]) && req.name[i] != '-' && req.name[i] != '_') {
+            return -EINVAL;
+        }
+    }
+    if (cmd == MQUEUE_IOC_CREATE_INSTANCE &&
+        (req.max_messages > INT_MAX || req.max_msg_size > MSG_SIZE_MAX ||
+         (unsigned long)req.max_total_bytes != req.max_total_bytes ||  // Truncaria em 32 bits
+         (unsigned long)req.max_queue_bytes != req.max_queue_bytes ||
+         req.overflow_policy > MQUEUE_OVERFLOW_BLOCK)) {
+        return -EINVAL;
+    }
+    snprintf(devname, sizeof(devname), DEVICE_NAME "-%s", req.name);
+
+    mutex_lock(&instance_lock);
+    idr_for_each_entry(&instance_idr, inst, id) {
+        if (strcmp(inst->name, devname) == 0) {
+            found = inst;
+            break;
+        }
+    }
+    if (cmd == MQUEUE_IOC_CREATE_INSTANCE) {
+        inst = found ? ERR_PTR(-EEXIST) : instance_create(devname, &req);
+        if (IS_ERR(inst)) {
+            ret = PTR_ERR(inst);
+        } else {
+            inst->dynamic = true;
+            req.minor = inst->minor;
+        }
+    } else if (!found || !found->dynamic) {
+        ret = found ? -EPERM : -ENOENT;  // As instâncias da carga vivem até a saída do módulo
+    } else {
+        instance_destroy(found);
+    }
+    mutex_unlock(&instance_lock);
+
+    if (!ret && cmd == MQUEUE_IOC_CREATE_INSTANCE && put_user(req.minor, &uarg->minor)) {
+        ret = -EFAULT;
+    }
+    return ret;
+}
+
+// Função de ioctl: API binária, ver mqueue.h
+static long dev_ioctl(struct file *filep, unsigned int cmd, unsigned long arg) {
+    void __user *argp = (void __user *)arg;
+    struct mq_client *client = filep->private_data;
+    struct process_s *own = READ_ONCE(client->own);
+    __s32 handle;
+
+    switch (cmd) {
+    case MQUEUE_IOC_REGISTER:
+    case MQUEUE_IOC_LOOKUP:
+        return ioctl_register(client, cmd, argp);
+    case MQUEUE_IOC_UNREGISTER:
+        if (get_user(handle, (__s32 __user *)argp)) {
+            return -EFAULT;
+        }
+        if (own && handle == own->handle) {
+            unregister_own(own);
+            return 0;
+        }
+        return unregister_handle(client->inst, handle, current->pid);
+    case MQUEUE_IOC_SEND_BATCH:
+    case MQUEUE_IOC_RECV_BATCH:
+        return ioctl_batch(filep, cmd, argp);
+    case MQUEUE_IOC_SUBSCRIBE:
+    case MQUEUE_IOC_UNSUBSCRIBE:
+        return ioctl_subscribe(own, cmd, argp);
+    case MQUEUE_IOC_PUBLISH:
+        return ioctl_publish(client->inst, argp);
+    case MQUEUE_IOC_SET_LIMITS:
+        return ioctl_limits(own, argp);
+    case MQUEUE_IOC_CREATE_INSTANCE:
+    case MQUEUE_IOC_DESTROY_INSTANCE:
+        return ioctl_instance(cmd, argp);
+    default:
+        return -ENOTTY;
+    }
+}
+
+// Retira de uma vez, sob o lock, as próximas mensagens de proc (por prioridade) que cabem em len
+// bytes de registros (cabeçalho mqueue_record + conteúdo). Modo lista: as mensagens
+// vão para consumed. Modo anel: os registros são montados em bounce, porque os slots
+// podem ser sobrescritos depois do unlock. Retorna os bytes de registros retirados,
+// 0 com a fila vazia ou -EMSGSIZE se nem a primeira mensagem cabe.
+static ssize_t dequeue_records(struct process_s *proc, size_t len, struct list_head *consumed, char *bounce) {
+    struct mqueue_record rec;
+    size_t total = 0;
 
-    if (sscanf(buffer, "/%s", target_process) == 1) {  // Envio de mensagem a um processo
-        list_for_each_entry(proc, &process_list, link) {  // Percorre a lista de processos
-            if (strcmp(proc->name, target_process) == 0) {
-                char *message = strchr(buffer, ' ') + 1;  // Obtém o conteúdo da mensagem
-                list_add_message_to_process(proc, message);  // Adiciona a mensagem à lista do processo
-                printk(KERN_INFO "Message sent to process %s: %s\n", target_process, message);
-                return len;
+    spin_lock(&proc->lock);
+    if (proc->dead) {                    // O anel de um processo desregistrado não vale mais
+        spin_unlock(&proc->lock);
+        return 0;
+    }
+    if (proc->ring) {
+        unsigned int tail = ring_tail(proc);
+
+        while (tail != proc->ring_head) {
+            struct mqueue_ring_slot *slot = ring_slot_at(proc, tail);
+
+            rec.len = ring_slot_len(proc, slot);  // Limitado ao slot: o cabeçalho é gravável pelo mmap
+            if (total + sizeof(rec) + rec.len > len) {
+                break;
             }
+            memcpy(bounce + total, &rec, sizeof(rec));
+            memcpy(bounce + total + sizeof(rec), slot->data, rec.len);
+            total += sizeof(rec) + rec.len;
+            tail++;
+            smp_store_release(&proc->ring->tail, tail);
+            note_dequeue(proc, rec.len);
         }
-        printk(KERN_INFO "Error: process %s not found\n", target_process);  // Processo não encontrado
-        return -EINVAL;
+    } else {
+        struct message_s *msg;
+
+        while ((msg = list_peek(proc))) {
+            if (total + sizeof(rec) + msg->size > len) {
+                break;
+            }
+            total += sizeof(rec) + msg->size;
+            list_unqueue(proc, msg);
+            list_add_tail(&msg->link, consumed);
+            note_dequeue(proc, msg->size);
+        }
+    }
+    if (total == 0 && process_msg_count(proc) > 0) {
+        spin_unlock(&proc->lock);
+        return -EMSGSIZE;                // A próxima mensagem não cabe no buffer do usuário
     }
+    spin_unlock(&proc->lock);
+    if (total) {
+        wake_writers(proc->inst);
+    }
+    return total;
+}
 
-    printk(KERN_INFO "Invalid command\n");  // Comando inválido
-    return -EINVAL;
+// Copia para o usuário os registros das mensagens retiradas no modo lista
+static int copy_records(char __user *buffer, struct list_head *consumed) {
+    struct mqueue_record rec;
+    struct message_s *msg;
+    size_t pos = 0;
+
+    list_for_each_entry(msg, consumed, link) {
+        rec.len = msg->size;
+        if (copy_to_user(buffer + pos, &rec, sizeof(rec)) ||
+            copy_to_user(buffer + pos + sizeof(rec), msg->message, rec.len)) {
+            return -EFAULT;
+        }
+        pos += sizeof(rec) + rec.len;
+    }
+    return 0;
 }
 
-// Função de leitura do dispositivo, que envia mensagens para o espaço do usuário
+// Função de leitura do dispositivo: retira as mensagens do processo registrado por
+// este arquivo e as entrega como registros com prefixo de tamanho (mqueue.h). Só
+// mensagens inteiras são entregues; o custo depende só da fila do próprio leitor.
 static ssize_t dev_read(struct file *filep, char *buffer, size_t len, loff_t *offset) {
-    struct process_s *proc;              // Ponteiro para iterar sobre os processos registrados
-    struct message_s *msg;               // Ponteiro para iterar sobre as mensagens de cada processo
-    char *tmp_buffer;                    // Buffer temporário para armazenar as mensagens antes de enviá-las ao espaço do usuário
-    int offset_len = 0;                  // Variável para acompanhar o tamanho atual do buffer temporário
-
-    // Aloca um buffer temporário para armazenar as mensagens, com tamanho máximo de 10 vezes o tamanho máximo de uma mensagem
-    tmp_buffer = kmalloc(max_msg_size * 10, GFP_KERNEL);  
-    if (!tmp_buffer) {                   // Verifica se a alocação foi bem-sucedida
-        printk(KERN_INFO "Memory allocation failed for temporary buffer\n");
-        return -ENOMEM;                  // Retorna erro se a alocação falhar
-    }
-
-    memset(tmp_buffer, 0, max_msg_size * 10);  // Inicializa o buffer temporário com zeros
-
-    // Percorre a lista de processos registrados para buscar as mensagens associadas a cada processo
-    list_for_each_entry(proc, &process_list, link) {
-        // Se o processo tiver mensagens na fila
-        if (!list_empty(&proc->msg_list)) {
-            // Percorre a lista de mensagens do processo
-            list_for_each_entry(msg, &proc->msg_list, link) {
-                // Adiciona as mensagens ao buffer temporário, formatando a saída com o nome do processo e o conteúdo da mensagem
-                offset_len += snprintf(tmp_buffer + offset_len, max_msg_size * 10 - offset_len, "Process %s message: %s\n", proc->name, msg->message);
-                // Verifica se o buffer temporário foi preenchido até o limite
-                if (offset_len >= max_msg_size * 10) {
-                    printk(KERN_INFO "Buffer overflow, truncating messages.\n");
-                    break;  // Se o buffer estourar, interrompe a adição de mensagens
-                }
-            }
+    struct mq_client *client = filep->private_data;
+    struct process_s *own = READ_ONCE(client->own);  // Processo registrado por este arquivo
+    LIST_HEAD(consumed);                 // Mensagens retiradas da lista, liberadas depois da cópia
+    char *bounce = NULL;                 // Registros do modo anel
+    ssize_t ret;
+
+    if (!own) {
+        return -EINVAL;                  // Sem /reg neste arquivo não há fila para ler
+    }
+    if (READ_ONCE(own->mapped)) {
+        return -EBUSY;                   // O consumidor lê direto do anel mapeado
+    }
+
+    if (own->ring) {                     // Não precisa ser maior que o anel cheio
+        len = min_t(size_t, len, (size_t)own->ring_slots * (sizeof(struct mqueue_record) + own->ring_slot_size));
+        bounce = kvmalloc(len, GFP_KERNEL);
+        if (!bounce) {
+            return -ENOMEM;
         }
     }
 
-    // Se não houver mensagens disponíveis em nenhum processo
-    if (offset_len == 0) {
-        printk(KERN_INFO "Mqueue Driver: No messages available to display.\n");
-        kfree(tmp_buffer);               // Libera a memória do buffer temporário
-        return 0;                        // Retorna 0, indicando que não há dados para ler
+    for (;;) {
+        ret = dequeue_records(own, len, &consumed, bounce);
+        if (ret != 0 || READ_ONCE(own->dead)) {
+            break;                       // Mensagens, erro ou processo desregistrado (fim de arquivo)
+        }
+        if (filep->f_flags & O_NONBLOCK) {
+            ret = -EAGAIN;
+            break;
+        }
+        if (wait_event_interruptible(own->wq, process_readable(own))) {
+            ret = -ERESTARTSYS;          // Interrompido por sinal
+            break;
+        }
     }
 
-    // Calcula o número correto de caracteres nas mensagens sem contar os extras
-    int message_len = 0;
-    list_for_each_entry(proc, &process_list, link) {
-        if (!list_empty(&proc->msg_list)) {
-            list_for_each_entry(msg, &proc->msg_list, link) {
-                message_len += strlen(msg->message);  // Soma o comprimento de cada mensagem
-            }
+    if (ret > 0) {
+        int err = bounce ? (copy_to_user(buffer, bounce, ret) ? -EFAULT : 0) : copy_records(buffer, &consumed);
+
+        if (err) {
+            ret = err;                   // As mensagens já foram retiradas da fila e se perdem
+        } else {
+            *offset += ret;              // Posição conta os bytes já consumidos do fluxo
         }
     }
 
-    // Copia o conteúdo do buffer temporário para o espaço do usuário
-    if (copy_to_user(buffer, tmp_buffer, offset_len)) {
-        printk(KERN_INFO "Mqueue Driver: Failed to send messages to the user.\n");
-        kfree(tmp_buffer);               // Libera o buffer temporário em caso de falha
-        return -EFAULT;                  // Retorna erro de falha na cópia para o espaço do usuário
+    free_message_list(&consumed);
+    kvfree(bounce);
+    return ret;
+}
+
+// Função de poll: o arquivo fica legível quando o processo registrado por ele tem mensagens
+static __poll_t dev_poll(struct file *filep, poll_table *wait) {
+    struct mq_client *client = filep->private_data;
+    struct process_s *own = READ_ONCE(client->own);
+    __poll_t mask = EPOLLOUT | EPOLLWRNORM;  // O destino de uma escrita só é conhecido no write
+
+    if (!own) {
+        return mask | EPOLLIN | EPOLLRDNORM;  // Sem processo vinculado a leitura não bloqueia
+    }
+
+    poll_wait(filep, &own->wq, wait);
+    if (process_msg_count(own) > 0) {
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+    if (READ_ONCE(own->dead)) {
+        mask |= EPOLLHUP;
+    }
+    return mask;
+}
+
+// Cada VMA do anel segura uma referência ao processo, então o anel continua
+// válido até o munmap mesmo depois do /unreg ou do close. As VMAs também são
+// contadas em mapped: com a última desfeita, read volta a consumir pelo kernel.
+static void ring_vm_open(struct vm_area_struct *vma) {
+    struct process_s *proc = vma->vm_private_data;
+
+    refcount_inc(&proc->refs);
+    spin_lock(&proc->lock);
+    proc->mapped++;
+    spin_unlock(&proc->lock);
+}
+
+static void ring_vm_close(struct vm_area_struct *vma) {
+    struct process_s *proc = vma->vm_private_data;
+
+    spin_lock(&proc->lock);
+    proc->mapped--;
+    spin_unlock(&proc->lock);
+    process_put(proc);
+}
+
+static const struct vm_operations_struct ring_vm_ops = {
+    .open = ring_vm_open,
+    .close = ring_vm_close,
+};
+
+// Função de mmap: mapeia o anel do processo registrado por este arquivo (queue_mode=1)
+static int dev_mmap(struct file *filep, struct vm_area_struct *vma) {
+    struct mq_client *client = filep->private_data;
+    struct process_s *own = READ_ONCE(client->own);
+    int ret;
+
+    if (!own || !own->ring) {
+        return -ENODEV;                  // Sem /reg neste arquivo ou fila em modo lista
+    }
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > own->ring_bytes) {
+        return -EINVAL;
+    }
+
+    ret = remap_vmalloc_range(vma, own->ring, 0);
+    if (ret) {
+        return ret;
+    }
+    vma->vm_ops = &ring_vm_ops;
+    vma->vm_private_data = own;
+    refcount_inc(&own->refs);            // open não é chamado para o mapeamento inicial
+
+    spin_lock(&own->lock);
+    own->mapped++;                       // Enquanto houver VMA o tail é do consumidor
+    spin_unlock(&own->lock);
+    return 0;
+}
+
+// Função de abertura do dispositivo: o arquivo fica preso à instância do minor aberto
+static int dev_open(struct inode *inodep, struct file *filep) {
+    struct mq_client *client;
+    struct mq_instance *inst;
+
+    client = kzalloc(sizeof(*client), GFP_KERNEL);
+    if (!client) {
+        return -ENOMEM;
     }
 
-    // Loga a quantidade de caracteres enviados para o espaço do usuário
-    printk(KERN_INFO "Mqueue Driver: Sent %d characters to the user\n", message_len);
+    mutex_lock(&instance_lock);
+    inst = idr_find(&instance_idr, iminor(inodep));
+    if (inst) {
+        kref_get(&inst->ref);
+    }
+    mutex_unlock(&instance_lock);
+    if (!inst) {                         // Instância destruída enquanto o open acontecia
+        kfree(client);
+        return -ENODEV;
+    }
 
-    kfree(tmp_buffer);                   // Libera a memória do buffer temporário
-    return message_len;                  // Retorna o número real de caracteres nas mensagens
+    client->inst = inst;
+    filep->private_data = client;
+    return 0;
 }
 
 // Função de fechamento do dispositivo
 static int dev_release(struct inode *inodep, struct file *filep) {
-    printk(KERN_INFO "Mqueue Driver: device successfully closed\n");
+    struct mq_client *client = filep->private_data;
+    struct process_s *own = client->own;
+
+    if (own) {
+        unregister_own(own);             // Cliente saiu sem /unreg: a fila não pode ficar para trás
+        process_put(own);                // Solta a referência do arquivo
+    }
+    instance_put(client->inst);
+    kfree(client);
+    mq_dbg("device successfully closed\n");
     return 0;
 }
 
-// Estrutura de operações de arquivo (read, write, release)
+// Estrutura de operações de arquivo (read, write, ioctl, poll, mmap, release)
 static struct file_operations fops = {
+    .owner = THIS_MODULE,                // Arquivos abertos seguram o módulo carregado
+    .open = dev_open,
     .read = dev_read,
     .write = dev_write,
+    .unlocked_ioctl = dev_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,    // Descritores com campos de tamanho fixo
+    .poll = dev_poll,
+    .mmap = dev_mmap,
     .release = dev_release,
 };
 
 // Função de inicialização do módulo
 static int __init mqueue_init(void) {
+    int i;
+
+    if (queue_mode != QUEUE_MODE_LIST && queue_mode != QUEUE_MODE_RING) {
+        printk(KERN_ALERT "Mqueue Driver: invalid queue_mode %d\n", queue_mode);
+        return -EINVAL;
+    }
+    if (overflow_policy < MQUEUE_OVERFLOW_DROP_OLDEST || overflow_policy > MQUEUE_OVERFLOW_BLOCK) {
+        printk(KERN_ALERT "Mqueue Driver: invalid overflow_policy %d\n", overflow_policy);
+        return -EINVAL;
+    }
+    if (nr_instances < 1 || nr_instances > MQUEUE_MAX_MINORS) {
+        printk(KERN_ALERT "Mqueue Driver: invalid nr_instances %d\n", nr_instances);
+        return -EINVAL;
+    }
+    if (max_messages < 1 || max_msg_size < 1 || max_msg_size > MSG_SIZE_MAX) {
+        printk(KERN_ALERT "Mqueue Driver: invalid message limits\n");
+        return -EINVAL;
+    }
+
+    msg_cache = KMEM_CACHE(message_s, SLAB_HWCACHE_ALIGN);  // Slab dos cabeçalhos de mensagem
+    if (!msg_cache) {
+        printk(KERN_ALERT "Mqueue Driver failed to create the message cache\n");
+        return -ENOMEM;
+    }
+
     majorNumber = register_chrdev(0, DEVICE_NAME, &fops);  // Registra o dispositivo e obtém o número major
     if (majorNumber < 0) {
+        kmem_cache_destroy(msg_cache);
         printk(KERN_ALERT "Mqueue Driver failed to register a major number\n");
         return majorNumber;
     }
     printk(KERN_INFO "Mqueue Driver: registered correctly with major number %d\n", majorNumber);  // Exibe o número major
 
-    mqueueClass = class_create(THIS_MODULE, CLASS_NAME);  // Cria a classe do dispositivo
+    mqueueClass = class_create(CLASS_NAME);  // Cria a classe do dispositivo
     if (IS_ERR(mqueueClass)) {
         unregister_chrdev(majorNumber, DEVICE_NAME);
+        kmem_cache_destroy(msg_cache);
         printk(KERN_ALERT "Failed to register device class\n");
         return PTR_ERR(mqueueClass);
     }
     printk(KERN_INFO "Mqueue Driver: device class registered correctly\n");
 
-    mqueueDevice = device_create(mqueueClass, NULL, MKDEV(majorNumber, 0), NULL, DEVICE_NAME);  // Cria o dispositivo
-    if (IS_ERR(mqueueDevice)) {
-        class_destroy(mqueueClass);
-        unregister_chrdev(majorNumber, DEVICE_NAME);
-        printk(KERN_ALERT "Failed to create the device\n");
-        return PTR_ERR(mqueueDevice);
+    // Instâncias da carga: /dev/mqueue0..N-1
+    debug_dir = debugfs_create_dir(DEVICE_NAME, NULL);
+    mutex_lock(&instance_lock);
+    for (i = 0; i < nr_instances; i++) {
+        char name[sizeof(DEVICE_NAME) + 4];
+        struct mq_instance *inst;
+
+        snprintf(name, sizeof(name), DEVICE_NAME "%d", i);
+        inst = instance_create(name, NULL);
+        if (IS_ERR(inst)) {
+            mutex_unlock(&instance_lock);
+            instance_destroy_all();
+            debugfs_remove_recursive(debug_dir);
+            class_destroy(mqueueClass);
+            unregister_chrdev(majorNumber, DEVICE_NAME);
+            rcu_barrier();
+            kmem_cache_destroy(msg_cache);
+            printk(KERN_ALERT "Failed to create the device %s\n", name);
+            return PTR_ERR(inst);
+        }
     }
-    printk(KERN_INFO "Mqueue Driver: device created correctly\n");
+    mutex_unlock(&instance_lock);
+    printk(KERN_INFO "Mqueue Driver: %d devices created correctly\n", nr_instances);
 
-    INIT_LIST_HEAD(&process_list);  // Inicializa a lista de processos
     printk(KERN_INFO "Mqueue Driver: initialized\n");
     return 0;
 }
 
 // Função de saída do módulo
+// Arquivos abertos (e anéis mapeados, que seguram o arquivo) prendem o módulo, então
+// aqui nenhum processo continua registrado: basta remover as instâncias.
 static void __exit mqueue_exit(void) {
-    device_destroy(mqueueClass, MKDEV(majorNumber, 0));  // Destrói o dispositivo
+    instance_destroy_all();
+    debugfs_remove_recursive(debug_dir);
     class_unregister(mqueueClass);  // Remove a classe do dispositivo
     class_destroy(mqueueClass);     // Destroi a classe
     unregister_chrdev(majorNumber, DEVICE_NAME);  // Remove o registro do dispositivo
+    idr_destroy(&instance_idr);
+    rcu_barrier();                  // Espera os callbacks do RCU antes de o código do módulo sumir
+    kmem_cache_destroy(msg_cache);  // Todas as mensagens já foram devolvidas
     printk(KERN_INFO "Mqueue Driver: exiting\n");
 }
 
@@ -5,15 +5,19 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "mqueue.h"
+
 #define BUFFER_LENGTH 256
+#define RECEIVE_LENGTH 4096  // Vários registros por leitura
 
 int main() {
     int ret, fd, len;  // Variáveis para armazenar o valor de retorno de funções, descritor de arquivo e o tamanho da string
-    char receive[BUFFER_LENGTH];  // Buffer para armazenar as mensagens lidas do dispositivo
+    char receive[RECEIVE_LENGTH];  // Buffer para armazenar os registros lidos do dispositivo
     char stringToSend[BUFFER_LENGTH];  // Buffer para armazenar os comandos/mensagens a serem enviados ao dispositivo
 
     // Abrir o dispositivo /dev/mqueue no modo leitura e escrita
-    fd = open("/dev/mqueue", O_RDWR);
+    // Não bloqueante: depois de um /reg a leitura esperaria mensagens para o processo registrado
+    fd = open("/dev/mqueue0", O_RDWR | O_NONBLOCK);
     if (fd < 0) {  // Verifica se o dispositivo foi aberto com sucesso
         perror("Failed to open the device..."); 
         return errno;  
@@ -40,21 +44,28 @@ int main() {
             continue;  // Continua no loop mesmo após um erro de escrita
         }
 
-        // Limpa o buffer de leitura antes de receber a resposta do dispositivo
-        memset(receive, 0, BUFFER_LENGTH);
-        // Lê a resposta do dispositivo
-        ret = read(fd, receive, BUFFER_LENGTH);  // Lê a mensagem do dispositivo
+        // Lê as mensagens do processo registrado por este programa (retiradas da fila)
+        ret = read(fd, receive, RECEIVE_LENGTH);
+        if (ret < 0 && (errno == EAGAIN || errno == EINVAL)) {  // Fila vazia ou nenhum /reg ainda
+            printf("No messages available to read.\n");
+            continue;
+        }
         if (ret < 0) {  // Verifica se a leitura foi bem-sucedida
             perror("Failed to read the message from the device.");  // Imprime a mensagem de erro, caso falhe
             continue;  // Continua no loop mesmo após um erro de leitura
         }
 
-        // Se houver uma mensagem recebida, a exibe
-        len = strnlen(receive, BUFFER_LENGTH);  // Calcula o comprimento da mensagem recebida
-        if (len > 0) {  // Se o comprimento for maior que zero, há uma mensagem para exibir
-            printf("Read message from device: [%s]\n", receive);  // Exibe a mensagem recebida do dispositivo
-        } else {
-            printf("No messages available to read.\n");  // Indica que não há mensagens para ler
+        // Percorre os registros: cabeçalho com o tamanho seguido do conteúdo
+        for (len = 0; len + (int)sizeof(struct mqueue_record) <= ret; ) {
+            struct mqueue_record rec;
+
+            memcpy(&rec, receive + len, sizeof(rec));
+            len += sizeof(rec);
+            printf("Read message from device: [%.*s]\n", (int)rec.len, receive + len);  // Exibe a mensagem recebida do dispositivo
+            len += rec.len;
+        }
+        if (ret == 0) {
+            printf("No messages available to read.\n");  // Processo desregistrado
         }
     }
 
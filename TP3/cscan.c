@@ -1,5 +1,14 @@
+/*
+ * Escalonador de IO C-SCAN para o block layer multi-fila (blk-mq, elevator_mq_ops).
+ * Cada contexto de hardware (hctx) tem seu próprio estado: índice por setor,
+ * posição da cabeça, lock e timer. As requisições de um hctx só são vistas pelo
+ * próprio hctx, então contextos diferentes nunca disputam o mesmo lock; só o hash
+ * de merge, que o block layer mantém por fila, tem um lock comum. Escrito
+ * contra a interface do Linux 6.5 em diante (insert_requests com blk_insert_t);
+ * o kernel alvo de todos os módulos do repositório é o 6.6 (ver KDIR no Makefile).
+ */
 #include <linux/blkdev.h>
-#include <linux/elevator.h>
+#include <linux/blk-mq.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/init.h>
@@ -8,19 +17,45 @@
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <linux/jiffies.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <trace/events/block.h>
+
+#include "elevator.h"    // Cabeçalhos internos de block/ (ccflags-y no Makefile)
+#include "blk-mq.h"
+#include "blk-mq-sched.h"
+#include "cscan_core.h"  // Índice por setor, também compilado fora do kernel
+
+/* Estado comum a todos os contextos de hardware (elevator_data) */
+struct cscan_queue {
+    spinlock_t merge_lock;              // Protege o hash de setores finais e q->last_merge, que são da fila
+    struct blk_mq_hw_ctx *merge_hctx;   // Contexto tentando um merge de bio, com merge_lock
+};
 
-/* Estrutura para o escalonador C-SCAN */
+/* Estrutura para o escalonador C-SCAN, uma por contexto de hardware (hctx->sched_data) */
 struct cscan_data {
-    struct list_head queue;        		// Lista de requisições de IO
+    spinlock_t lock;                    // Protege todos os campos abaixo; tomado antes de merge_lock
+    struct blk_mq_hw_ctx *hctx;         // Contexto de hardware dono desta estrutura
+    struct list_head dispatch;          // Requisições que vão à frente da varredura (passthrough, inserção no início)
+    struct rb_root sort_root;      		// Requisições de IO pendentes, indexadas por setor
     struct timer_list dispatch_timer; 	// Timer para timeout e despacho periódico
+    unsigned long deadline;             // Jiffies em que as requisições acumuladas deixam de esperar
+    bool draining;                      // Despacho em andamento: fila cheia ou tempo esgotado
+    int batch;                          // Requisições despachadas no despacho em andamento
     int request_count;              	// Contador de requisições na fila
+    sector_t head_pos;                  // Posição da cabeça: setor da última requisição despachada
+    sector_t capacity;                  // Capacidade do dispositivo em setores (fim do disco)
+    struct processed_list *sweep;       // Bloco da varredura em andamento, NULL entre varreduras
     struct list_head processed_list; 	// Lista para armazenar blocos de setores processados
+    int processed_blocks;               // Blocos guardados em processed_list, no máximo CSCAN_MAX_BLOCKS
 };
 
 /* Parâmetros default */
 static int cscan_queue_size = 10; // Tamanho máximo da fila de requisições
 static int cscan_max_wait = 100;  // Timeout em milissegundos para o despacho
-static int cscan_debug = 1;  	  // Ativa ou desativa mensagens de depuração
+#define CSCAN_MAX_BLOCKS 32       // Varreduras guardadas para o resumo; as mais antigas são descartadas
+
+static int cscan_debug = 0;  	  // Ativa mensagens de depuração e o registro das varreduras
 
 /* Parâmetros do módulo */
 module_param(cscan_queue_size, int, 0644);  
@@ -28,7 +63,7 @@ MODULE_PARM_DESC(cscan_queue_size, "Tamanho da fila de requisições (5-100)");
 module_param(cscan_max_wait, int, 0644);  
 MODULE_PARM_DESC(cscan_max_wait, "Tempo máximo de espera em ms (1-100)");
 module_param(cscan_debug, int, 0644);  
-MODULE_PARM_DESC(cscan_debug, "Habilitar mensagens de depuração"); 
+MODULE_PARM_DESC(cscan_debug, "Habilitar mensagens de depuração e o registro dos setores de cada varredura"); 
 
 /* Estrutura para armazenar blocos de setores processados */
 struct processed_list {
@@ -39,7 +74,7 @@ struct processed_list {
 /* Estrutura para armazenar setores processados */
 struct processed_sector {
     struct list_head list;             // Nó para vincular na lista de setores dentro de um bloco
-    unsigned long sector;              // Número do setor processado
+    sector_t sector;                   // Número do setor processado
 };
 
 /* Função para imprimir todos os setores processados até o momento */
@@ -56,268 +91,455 @@ static void print_all_processed(struct cscan_data *cd) {
     list_for_each_entry(block, &cd->processed_list, list) {  // Itera sobre cada bloco
         printk(KERN_INFO "C-SCAN [block]:");  
         list_for_each_entry(ps, &block->sectors, list) {  // Itera sobre cada setor no bloco
-            printk(KERN_CONT " %lu", ps->sector);  
+            printk(KERN_CONT " %llu", (unsigned long long)ps->sector);  
         }
         printk(KERN_INFO "\n");
     }
 }
 
-/* Função para ordenar a fila em ordem crescente de setores */
-static void sort_queue(struct cscan_data *cd) {
-    struct list_head sorted_queue;
-    struct request *rq, *tmp;
-
-    INIT_LIST_HEAD(&sorted_queue); // Inicializa uma lista temporária para ordenar as requisições
+/* Setor de uma requisição do índice, para o núcleo do C-SCAN */
+static sector_t cscan_rq_pos(const struct rb_node *node) {
+    return blk_rq_pos(rb_entry(node, struct request, rb_node));
+}
 
-    while (!list_empty(&cd->queue)) {
-        struct request *min_rq = NULL;
-        unsigned long min_sector = ULONG_MAX;
 
-        list_for_each_entry_safe(rq, tmp, &cd->queue, queuelist) {
-            unsigned long sector = blk_rq_pos(rq);
-            if (sector < min_sector) {
-                min_sector = sector;
-                min_rq = rq;
-            }
-        }
+/* Registra um setor no bloco da varredura em andamento */
+static void cscan_record_sector(struct processed_list *block, sector_t sector) {
+    struct processed_sector *ps = kmalloc(sizeof(*ps), GFP_ATOMIC);  // O despacho roda com cd->lock
 
-        if (min_rq) {
-            list_del_init(&min_rq->queuelist); // Remove a requisição com o menor setor da fila original
-            list_add_tail(&min_rq->queuelist, &sorted_queue); // Adiciona na fila ordenada
-        }
+    if (!ps) {  // Verifica falha de alocação
+        printk(KERN_ERR "C-SCAN [dispatch]: Falha ao alocar memória para setor processado\n");
+        return;
     }
-
-    // Substitui a fila original pela fila ordenada
-    list_splice_tail_init(&sorted_queue, &cd->queue);
+    ps->sector = sector;
+    list_add_tail(&ps->list, &block->sectors);
 }
 
+/* Abre o bloco de uma nova varredura, que começa no setor 0 */
+static void cscan_start_sweep(struct cscan_data *cd) {
+    struct processed_list *block = kmalloc(sizeof(*block), GFP_ATOMIC);
 
-/* Função para despachar todas as requisições acumuladas na fila */
-static int cscan_dispatch(struct request_queue *q, int force) {
-    struct cscan_data *cd = q->elevator->elevator_data;  // Obtém os dados do escalonador
-    struct processed_sector *ps;  // Ponteiro para setores processados
-    struct processed_list *processed_block;  // Ponteiro para blocos processados
-
-    if (!cd || list_empty(&cd->queue)) {  // Verifica se a fila está vazia
+    if (!block) {
         if (cscan_debug) {
-            printk(KERN_INFO "C-SCAN [dispatch]: Fila vazia ou estrutura nula\n");
+            printk(KERN_ERR "C-SCAN [dispatch]: Falha ao alocar memória para bloco processado\n");
         }
-        return 0;
+        return;  // A varredura segue sem registro
     }
-
+    INIT_LIST_HEAD(&block->sectors);
+    cscan_record_sector(block, 0);  // Adiciona o setor inicial (0)
+    cd->sweep = block;
     if (cscan_debug) {
-        printk(KERN_INFO "C-SCAN [dispatch]: Ordenando a fila por número de setor\n");
+        printk(KERN_INFO "C-SCAN [dispatch]: Setor inicial [0] adicionado ao bloco\n");
     }
+}
 
-    // Ordena a fila em ordem crescente de setores
-    sort_queue(cd);
+/* Libera um bloco e seus setores */
+static void cscan_free_block(struct processed_list *block) {
+    struct processed_sector *ps, *tmp_ps;
 
-    if (cscan_debug) {
-        printk(KERN_INFO "C-SCAN [dispatch]: Iniciando processamento da lista ordenada\n");
+    list_for_each_entry_safe(ps, tmp_ps, &block->sectors, list) {
+        kfree(ps);
     }
+    kfree(block);
+}
 
-    // Aloca memória para um novo bloco de setores processados
-    processed_block = kmalloc(sizeof(*processed_block), GFP_KERNEL);
-    if (!processed_block) { 
-        if (cscan_debug) {
-            printk(KERN_ERR "C-SCAN [dispatch]: Falha ao alocar memória para bloco processado\n");
-        }
-        return -ENOMEM;
+/* Fecha a varredura em andamento no fim do disco, guarda o bloco e imprime seus setores */
+static void cscan_end_sweep(struct cscan_data *cd) {
+    struct processed_list *block = cd->sweep;
+    struct processed_sector *ps;
+
+    if (!block) {
+        return;
+    }
+    cscan_record_sector(block, cd->capacity);  // Adiciona o setor final (fim do disco)
+    list_add_tail(&block->list, &cd->processed_list);
+    cd->sweep = NULL;
+    if (++cd->processed_blocks > CSCAN_MAX_BLOCKS) {  // Mantém a memória do registro limitada
+        struct processed_list *oldest = list_first_entry(&cd->processed_list, struct processed_list, list);
+
+        list_del(&oldest->list);
+        cscan_free_block(oldest);
+        cd->processed_blocks--;
     }
-    INIT_LIST_HEAD(&processed_block->sectors);  // Inicializa a lista de setores no bloco
 
-    // Adiciona o setor inicial (0)
-    ps = kmalloc(sizeof(*ps), GFP_KERNEL);
-    if (ps) {
-        ps->sector = 0;  // Define o setor inicial
-        list_add_tail(&ps->list, &processed_block->sectors);
-        if (cscan_debug) {
-            printk(KERN_INFO "C-SCAN [dispatch]: Setor inicial [0] adicionado ao bloco\n");
-        }
+    printk(KERN_INFO "C-SCAN [block]: Setores processados neste bloco:");
+    list_for_each_entry(ps, &block->sectors, list) {
+        printk(KERN_CONT " %llu", (unsigned long long)ps->sector);
     }
+    printk(KERN_INFO "\n");
+}
 
-    // Percorre os setores em ordem crescente
-    while (!list_empty(&cd->queue)) {  // Processa enquanto houver requisições na fila
-        struct request *rq = list_first_entry(&cd->queue, struct request, queuelist);  // Obtém a primeira requisição
-        if (!rq) {  
-            printk(KERN_ERR "C-SCAN [dispatch]: Requisição nula encontrada\n");
-            continue;
-        }
+/* Retira rq do índice e do hash de merge. Chamada com cd->lock e merge_lock */
+static void cscan_remove_request(struct request_queue *q, struct cscan_data *cd, struct request *rq) {
+    cscan_index_del(&cd->sort_root, &rq->rb_node);
+    cd->request_count--;  // Decrementa o contador de requisições
+    elv_rqhash_del(q, rq);
+    if (q->last_merge == rq) {
+        q->last_merge = NULL;
+    }
+}
 
-        unsigned long sector = blk_rq_pos(rq);  // Obtém o setor da requisição
-        list_del_init(&rq->queuelist);  // Remove a requisição da fila
-        cd->request_count--;  // Decrementa o contador de requisições
+/* Prazo de espera das requisições acumuladas; o timer roda a fila quando ele vence */
+static void cscan_arm_deadline(struct cscan_data *cd) {
+    cd->deadline = jiffies + msecs_to_jiffies(cscan_max_wait);
+    mod_timer(&cd->dispatch_timer, cd->deadline);
+}
 
-        // Aloca memória para o setor processado
-        ps = kmalloc(sizeof(*ps), GFP_KERNEL);
-        if (!ps) {  // Verifica falha de alocação
-            printk(KERN_ERR "C-SCAN [dispatch]: Falha ao alocar memória para setor processado\n");
-            continue;
+/*
+ * Retira a próxima requisição da varredura, a partir da posição da cabeça e em
+ * ordem crescente de setor; requisições que chegam à frente da cabeça entram na
+ * varredura em andamento. As requisições se acumulam até a fila encher ou o tempo
+ * de espera vencer; então o despacho serve o que resta da varredura atual (ou, se
+ * nada está à frente da cabeça, volta ao início e serve a próxima varredura
+ * inteira). Chamada com cd->lock.
+ */
+static struct request *cscan_next_request(struct cscan_data *cd) {
+    struct request_queue *q = cd->hctx->queue;
+    struct cscan_queue *cq = q->elevator->elevator_data;
+    struct rb_node *node;  // Próxima requisição da varredura
+    struct request *rq;
+    sector_t sector;
+    bool wrapped;          // A próxima requisição está atrás da cabeça
+
+    if (!cd->draining) {
+        if (cd->request_count < cscan_queue_size && time_before(jiffies, cd->deadline)) {
+            return NULL;  // Continua acumulando
         }
-        ps->sector = sector;  // Define o número do setor
-        list_add_tail(&ps->list, &processed_block->sectors);  // Adiciona o setor ao bloco
-
         if (cscan_debug) {
-            printk(KERN_INFO "C-SCAN [dispatch]: Setor [%lu] processado, requisições restantes [%d]\n",
-                   sector, cd->request_count);
+            printk(KERN_INFO "C-SCAN [dispatch]: %s, despachando requisições\n",
+                   cd->request_count >= cscan_queue_size ? "Fila cheia" : "Tempo de espera esgotado");
         }
+        cd->draining = true;
+        cd->batch = 0;
+    }
 
-        elv_dispatch_sort(q, rq);  // Despacha a requisição
+    node = cscan_index_next(&cd->sort_root, cd->head_pos, cscan_rq_pos, &wrapped);
+    if (node && wrapped && cd->batch) {
+        node = NULL;  // O que está atrás da cabeça fica para a próxima varredura
+    }
+    if (!node) {
+        cd->draining = false;
+        if (cd->request_count) {
+            cscan_arm_deadline(cd);  // As que sobraram voltam a acumular
+        }
+        return NULL;
     }
 
-    // Adiciona o setor final (fim do disco)
-    ps = kmalloc(sizeof(*ps), GFP_KERNEL);
-    if (ps) {
-        unsigned long max_sector = 2097152;  // Valor máximo do setor (exemplo)
-        ps->sector = max_sector;  // Define o setor final
-        list_add_tail(&ps->list, &processed_block->sectors);
+    if (wrapped) {
         if (cscan_debug) {
-            printk(KERN_INFO "C-SCAN [dispatch]: Setor final [%lu] adicionado ao bloco\n", max_sector);
+            printk(KERN_INFO "C-SCAN [dispatch]: Nada à frente do setor [%llu], movendo para o fim do disco\n",
+                   (unsigned long long)cd->head_pos);
+            printk(KERN_INFO "C-SCAN [dispatch]: Retornando ao início do disco para o próximo bloco\n");
         }
+        cscan_end_sweep(cd);
+    }
+    if (cscan_debug && !cd->sweep) {  // Sem depuração o despacho não aloca nem registra nada
+        cscan_start_sweep(cd);
     }
 
-    // Adiciona o bloco processado à lista geral
-    list_add_tail(&processed_block->list, &cd->processed_list);
-
-    // Imprime os setores do bloco após o processamento
-    printk(KERN_INFO "C-SCAN [block]: Setores processados neste bloco:");
-    list_for_each_entry(ps, &processed_block->sectors, list) {
-        printk(KERN_CONT " %lu", ps->sector);
+    rq = rb_entry(node, struct request, rb_node);
+    sector = blk_rq_pos(rq);  // Obtém o setor da requisição
+    spin_lock(&cq->merge_lock);
+    cscan_remove_request(q, cd, rq);  // Sai do hash antes de ir ao driver: nenhuma bio entra nela depois
+    spin_unlock(&cq->merge_lock);
+    cd->batch++;
+    cd->head_pos = sector;  // A cabeça vai até o setor despachado
+    if (cd->sweep) {
+        cscan_record_sector(cd->sweep, sector);
     }
-    printk(KERN_INFO "\n");
 
     if (cscan_debug) {
-        printk(KERN_INFO "C-SCAN [dispatch]: Movendo para o fim do disco\n");
-        printk(KERN_INFO "C-SCAN [dispatch]: Retornando ao início do disco para o próximo bloco\n");
+        printk(KERN_INFO "C-SCAN [dispatch]: Setor [%llu] processado, requisições restantes [%d]\n",
+               (unsigned long long)sector, cd->request_count);
+    }
+    return rq;
+}
+
+/* Entrega ao driver a próxima requisição deste contexto de hardware */
+static struct request *cscan_dispatch_request(struct blk_mq_hw_ctx *hctx) {
+    struct cscan_data *cd = hctx->sched_data;  // Obtém os dados do escalonador
+    struct request *rq;
+
+    spin_lock(&cd->lock);
+    rq = list_first_entry_or_null(&cd->dispatch, struct request, queuelist);
+    if (rq) {
+        list_del_init(&rq->queuelist);  // Fora da varredura: vai direto
+    } else {
+        rq = cscan_next_request(cd);
     }
+    spin_unlock(&cd->lock);
 
-    return 1;  // Retorna sucesso
+    return rq;
 }
 
+/* Há o que despachar: requisições fora da varredura, despacho em andamento, fila cheia ou tempo esgotado */
+static bool cscan_has_work(struct blk_mq_hw_ctx *hctx) {
+    struct cscan_data *cd = hctx->sched_data;
 
-/* Adiciona uma requisição à fila */
-static void cscan_add_request(struct request_queue *q, struct request *rq) {
-    struct cscan_data *cd = q->elevator->elevator_data;  // Obtém os dados do escalonador
+    if (!list_empty_careful(&cd->dispatch)) {
+        return true;
+    }
+    if (!READ_ONCE(cd->request_count)) {
+        return false;
+    }
+    return READ_ONCE(cd->draining) || READ_ONCE(cd->request_count) >= cscan_queue_size ||
+           time_after_eq(jiffies, READ_ONCE(cd->deadline));
+}
 
-    unsigned long sector = blk_rq_pos(rq);  // Obtém o setor da requisição
+/* Adiciona requisições à fila do contexto de hardware */
+static void cscan_insert_requests(struct blk_mq_hw_ctx *hctx, struct list_head *list, blk_insert_t flags) {
+    struct cscan_data *cd = hctx->sched_data;  // Obtém os dados do escalonador
+    struct request_queue *q = hctx->queue;
+    struct cscan_queue *cq = q->elevator->elevator_data;
 
-    list_add_tail(&rq->queuelist, &cd->queue);  // Adiciona a requisição à fila
-    cd->request_count++;  // Incrementa o contador de requisições
+    spin_lock(&cd->lock);
+    while (!list_empty(list)) {
+        struct request *rq = list_first_entry(list, struct request, queuelist);
 
-    if (cscan_debug) {
-        printk(KERN_INFO "C-SCAN [add]: Adicionando setor [%lu]\n", sector);
+        list_del_init(&rq->queuelist);
+        trace_block_rq_insert(rq);
+
+        if (blk_rq_is_passthrough(rq) || (flags & BLK_MQ_INSERT_AT_FRONT)) {
+            list_add_tail(&rq->queuelist, &cd->dispatch);  // Sem setor de disco ou pedida no início
+            continue;
+        }
+
+        if (q->disk) {
+            cd->capacity = get_capacity(q->disk);  // Fim do disco do próprio dispositivo
+        }
+        if (!cd->request_count && !cd->draining) {
+            cscan_arm_deadline(cd);  // Primeira da fila: começa a contar o tempo de espera
+        }
+        cscan_index_add(&cd->sort_root, &rq->rb_node, cscan_rq_pos);  // Insere no índice por setor, O(log n)
+        cd->request_count++;  // Incrementa o contador de requisições
+        if (rq_mergeable(rq)) {
+            spin_lock(&cq->merge_lock);
+            elv_rqhash_add(q, rq);  // Candidata a back merge pelo setor final
+            if (!q->last_merge) {
+                q->last_merge = rq;
+            }
+            spin_unlock(&cq->merge_lock);
+        }
+
+        if (cscan_debug) {
+            printk(KERN_INFO "C-SCAN [add]: Adicionando setor [%llu]\n", (unsigned long long)blk_rq_pos(rq));
+        }
     }
+    spin_unlock(&cd->lock);
+}
 
-    if (cd->request_count >= cscan_queue_size) {  // Verifica se a fila atingiu o tamanho máximo
-        printk(KERN_INFO "C-SCAN [add]: Fila cheia, despachando requisições\n");
-        cscan_dispatch(q, 1);  // Despacha as requisições
+/*
+ * Tenta juntar a bio a uma requisição pendente do contexto de hardware da CPU
+ * atual. O block layer procura o back merge no hash de setores finais (e em
+ * q->last_merge) e pede o front merge a cscan_request_merge.
+ */
+static bool cscan_bio_merge(struct request_queue *q, struct bio *bio, unsigned int nr_segs) {
+    struct cscan_queue *cq = q->elevator->elevator_data;
+    struct blk_mq_hw_ctx *hctx = blk_mq_map_queue(q, bio->bi_opf, blk_mq_get_ctx(q));
+    struct cscan_data *cd = hctx->sched_data;
+    struct request *free = NULL;  // Requisição absorvida por outra depois do merge
+    bool merged;
+
+    spin_lock(&cd->lock);
+    spin_lock(&cq->merge_lock);
+    cq->merge_hctx = hctx;  // cscan_allow_merge recusa requisições de outros contextos
+    merged = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
+    cq->merge_hctx = NULL;
+    spin_unlock(&cq->merge_lock);
+    spin_unlock(&cd->lock);
+
+    if (free) {
+        blk_mq_free_request(free);
     }
+    return merged;
 }
 
-/* Callback do timer */
-static void cscan_dispatch_timer(unsigned long data) {
-    struct cscan_data *cd = (struct cscan_data *)data; // Obtém a estrutura do escalonador (cscan_data) a partir do dado passado para o timer
+/* Front merge: requisição pendente que começa no setor em que a bio termina, pelo índice por setor */
+static int cscan_request_merge(struct request_queue *q, struct request **rq, struct bio *bio) {
+    struct cscan_queue *cq = q->elevator->elevator_data;
+    sector_t sector = bio_end_sector(bio);
+    struct cscan_data *cd;
+    struct rb_node *node;
 
-    // Verifica se a estrutura ou os dados do timer são nulos e reporta um erro, se necessário
-    if (!cd || !cd->dispatch_timer.data) {
-        printk(KERN_ERR "C-SCAN [timer]: Estrutura de dados nula ou inválida\n");
-        return;
+    if (!cq->merge_hctx) {
+        return ELEVATOR_NO_MERGE;
     }
+    cd = cq->merge_hctx->sched_data;
 
-    // Se há requisições na fila, tenta processá-las
-    if (cd->request_count > 0) {
-        struct request_queue *q = (struct request_queue *)cd->dispatch_timer.data; // Obtém a fila de requisições associada a partir dos dados do timer
-        
-        // Verifica se a fila de requisições é nula e reporta um erro, se necessário
-        if (!q) {
-            printk(KERN_ERR "C-SCAN [timer]: Ponteiro de fila nulo\n");
-            return;
+    // Setores iguais podem ter direções diferentes: tenta cada uma, da mais antiga à mais nova
+    node = cscan_index_find(&cd->sort_root, sector, cscan_rq_pos);
+    for (; node && cscan_rq_pos(node) == sector; node = rb_next(node)) {
+        struct request *__rq = rb_entry(node, struct request, rb_node);
+
+        if (elv_bio_merge_ok(__rq, bio)) {
+            *rq = __rq;
+            if (blk_discard_mergable(__rq)) {
+                return ELEVATOR_DISCARD_MERGE;
+            }
+            return ELEVATOR_FRONT_MERGE;
         }
+    }
+    return ELEVATOR_NO_MERGE;
+}
 
-        cscan_dispatch(q, 1); // Despacha as requisições pendentes na fila
+/* A bio entrou em rq; num front merge o setor inicial recuou e rq muda de lugar no índice */
+static void cscan_request_merged(struct request_queue *q, struct request *rq, enum elv_merge type) {
+    struct cscan_data *cd = rq->mq_hctx->sched_data;
+
+    if (type == ELEVATOR_FRONT_MERGE) {
+        cscan_index_del(&cd->sort_root, &rq->rb_node);
+        cscan_index_add(&cd->sort_root, &rq->rb_node, cscan_rq_pos);
     }
+    if (cscan_debug) {
+        printk(KERN_INFO "C-SCAN [merge]: %s merge no setor [%llu], %u setores\n",
+               type == ELEVATOR_FRONT_MERGE ? "Front" : "Back", (unsigned long long)blk_rq_pos(rq),
+               blk_rq_sectors(rq));
+    }
+}
 
-    mod_timer(&cd->dispatch_timer, jiffies + msecs_to_jiffies(cscan_max_wait)); // Reprograma o timer para disparar novamente após cscan_max_wait milissegundos
+/* next foi absorvida por rq (requisições adjacentes) e deixa o escalonador */
+static void cscan_requests_merged(struct request_queue *q, struct request *rq, struct request *next) {
+    struct cscan_data *cd = next->mq_hctx->sched_data;
+
+    if (!RB_EMPTY_NODE(&next->rb_node)) {
+        cscan_remove_request(q, cd, next);
+    }
+    if (cscan_debug) {
+        printk(KERN_INFO "C-SCAN [merge]: Setor [%llu] absorvido pelo setor [%llu]\n",
+               (unsigned long long)blk_rq_pos(next), (unsigned long long)blk_rq_pos(rq));
+    }
 }
 
-/* Inicializa o escalonador */
-static int cscan_init_queue(struct request_queue *q, struct elevator_type *e) {
-    struct elevator_queue *eq; // Estrutura do elevador (escalonador)
-    struct cscan_data *cd;     // Estrutura de dados do escalonador C-SCAN
+/*
+ * Só junta bios a requisições do contexto que está fazendo o merge: o índice de
+ * outro contexto é protegido pelo lock dele, que não está tomado.
+ */
+static bool cscan_allow_merge(struct request_queue *q, struct request *rq, struct bio *bio) {
+    struct cscan_queue *cq = q->elevator->elevator_data;
 
-    // Aloca uma nova estrutura de elevador associada à fila e ao tipo do escalonador
-    eq = elevator_alloc(q, e);
-    if (!eq) { // Verifica se a alocação falhou
-        return -ENOMEM; // Retorna erro de memória insuficiente
+    if (RB_EMPTY_NODE(&rq->rb_node)) {
+        return true;  // Ainda fora do escalonador (plug do processo)
     }
+    return rq->mq_hctx == cq->merge_hctx;
+}
 
-    // Aloca memória para a estrutura de dados específica do C-SCAN
-    cd = kmalloc(sizeof(*cd), GFP_KERNEL);
+/* Callback do timer: o tempo de espera venceu, roda a fila do contexto de hardware */
+static void cscan_dispatch_timer(struct timer_list *t) {
+    struct cscan_data *cd = from_timer(cd, t, dispatch_timer);  // Obtém a estrutura do escalonador a partir do timer
+
+    if (READ_ONCE(cd->request_count) > 0) {
+        blk_mq_run_hw_queue(cd->hctx, true);  // Assíncrono: o despacho roda fora do contexto do timer
+    }
+}
+
+/* Inicializa o estado de um contexto de hardware */
+static int cscan_init_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx) {
+    struct cscan_data *cd;     // Estrutura de dados do escalonador C-SCAN
+
+    // Aloca memória para a estrutura de dados do C-SCAN, no nó NUMA do contexto
+    cd = kzalloc_node(sizeof(*cd), GFP_KERNEL, hctx->numa_node);
     if (!cd) { // Verifica se a alocação falhou
-        kobject_put(&eq->kobj); // Libera a estrutura do elevador previamente alocada
         return -ENOMEM; // Retorna erro de memória insuficiente
     }
 
-    // Inicializa a lista de requisições (fila principal)
-    INIT_LIST_HEAD(&cd->queue);
+    spin_lock_init(&cd->lock);
+    cd->hctx = hctx;
+    INIT_LIST_HEAD(&cd->dispatch);
+
+    // Inicializa o índice de requisições pendentes (fila principal)
+    cd->sort_root = RB_ROOT;
 
     // Inicializa a lista de setores processados
     INIT_LIST_HEAD(&cd->processed_list);
 
-    // Inicializa o contador de requisições como 0
-    cd->request_count = 0;
-
-    // Configura o timer para gerenciar o timeout de requisições
-    init_timer(&cd->dispatch_timer); // Inicializa o timer
-    cd->dispatch_timer.function = cscan_dispatch_timer; // Define a função de callback do timer
-    cd->dispatch_timer.data = (unsigned long)q; // Armazena o ponteiro para a request_queue no timer
+    // A cabeça começa no setor 0; a capacidade vem do disco na primeira requisição
+    cd->head_pos = 0;
+    cd->capacity = 0;
+    cd->sweep = NULL;
 
-    // Agenda o timer para disparar após o intervalo definido (cscan_max_wait)
-    mod_timer(&cd->dispatch_timer, jiffies + msecs_to_jiffies(cscan_max_wait));
+    // Configura o timer para gerenciar o timeout de requisições; é armado na primeira requisição
+    timer_setup(&cd->dispatch_timer, cscan_dispatch_timer, 0);
 
-    // Associa os dados do escalonador ao elevador e configura na fila
-    eq->elevator_data = cd; // Armazena a estrutura cscan_data no elevador
-    spin_lock_irq(q->queue_lock); // Bloqueia a fila para proteger contra concorrência
-    q->elevator = eq; // Associa o elevador configurado à fila de requisições
-    spin_unlock_irq(q->queue_lock); // Libera a fila
-
-    return 0; // Retorna sucesso na inicialização
+    hctx->sched_data = cd;
+    return 0;
 }
 
-/* Finaliza o escalonador */
-static void cscan_exit_queue(struct elevator_queue *e) {
-    struct cscan_data *cd = e->elevator_data;
+/* Finaliza o estado de um contexto de hardware; a fila já está congelada e vazia */
+static void cscan_exit_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx) {
+    struct cscan_data *cd = hctx->sched_data;
     struct processed_list *block, *tmp_block;
-    struct processed_sector *ps, *tmp_ps;
+    struct processed_sector *ps;
+
+    del_timer_sync(&cd->dispatch_timer);
+    WARN_ON_ONCE(!RB_EMPTY_ROOT(&cd->sort_root) || !list_empty(&cd->dispatch));
+
+    cscan_end_sweep(cd);  // Guarda o bloco da varredura em andamento
 
     // Imprime uma única mensagem consolidando todos os setores processados
-    printk(KERN_INFO "C-SCAN [summary]: Consolidando todos os setores processados:\n");
-    list_for_each_entry(block, &cd->processed_list, list) {
-        list_for_each_entry(ps, &block->sectors, list) {
-            printk(KERN_CONT " %lu", ps->sector);
+    if (!list_empty(&cd->processed_list)) {
+        printk(KERN_INFO "C-SCAN [summary]: Consolidando todos os setores processados (hctx %u):\n", hctx_idx);
+        list_for_each_entry(block, &cd->processed_list, list) {
+            list_for_each_entry(ps, &block->sectors, list) {
+                printk(KERN_CONT " %llu", (unsigned long long)ps->sector);
+            }
         }
+        printk(KERN_INFO "\n");
     }
-    printk(KERN_INFO "\n");
 
     // Libera todos os blocos e setores processados
     list_for_each_entry_safe(block, tmp_block, &cd->processed_list, list) {
-        list_for_each_entry_safe(ps, tmp_ps, &block->sectors, list) {
-            kfree(ps);
-        }
-        kfree(block);
+        cscan_free_block(block);
     }
 
-    del_timer_sync(&cd->dispatch_timer);
+    hctx->sched_data = NULL;
     kfree(cd);
 }
 
+/* Inicializa o escalonador; o estado da varredura fica nos contextos de hardware */
+static int cscan_init_sched(struct request_queue *q, struct elevator_type *e) {
+    struct elevator_queue *eq; // Estrutura do elevador (escalonador)
+    struct cscan_queue *cq;    // Estado comum aos contextos de hardware
+
+    // Aloca uma nova estrutura de elevador associada à fila e ao tipo do escalonador
+    eq = elevator_alloc(q, e);
+    if (!eq) { // Verifica se a alocação falhou
+        return -ENOMEM; // Retorna erro de memória insuficiente
+    }
+
+    cq = kzalloc_node(sizeof(*cq), GFP_KERNEL, q->node);
+    if (!cq) {
+        kobject_put(&eq->kobj); // Libera a estrutura do elevador previamente alocada
+        return -ENOMEM;
+    }
+    spin_lock_init(&cq->merge_lock);
+    eq->elevator_data = cq;
+
+    q->elevator = eq; // Associa o elevador à fila; o blk-mq chama init_hctx em seguida
+    return 0; // Retorna sucesso na inicialização
+}
+
+/* Finaliza o escalonador */
+static void cscan_exit_sched(struct elevator_queue *e) {
+    kfree(e->elevator_data);  // exit_hctx já liberou o estado de cada contexto
+}
+
 /* Estrutura do escalonador */
 static struct elevator_type elevator_cscan = {
-    .ops.sq = {
-        .elevator_add_req_fn  = cscan_add_request,
-        .elevator_dispatch_fn = cscan_dispatch,
-        .elevator_init_fn     = cscan_init_queue,
-        .elevator_exit_fn     = cscan_exit_queue,
+    .ops = {
+        .insert_requests  = cscan_insert_requests,
+        .dispatch_request = cscan_dispatch_request,
+        .has_work         = cscan_has_work,
+        .bio_merge        = cscan_bio_merge,
+        .request_merge    = cscan_request_merge,
+        .request_merged   = cscan_request_merged,
+        .requests_merged  = cscan_requests_merged,
+        .allow_merge      = cscan_allow_merge,
+        .next_request     = elv_rb_latter_request,  // Vizinhas no índice, para juntar requisições adjacentes
+        .former_request   = elv_rb_former_request,
+        .init_sched       = cscan_init_sched,
+        .exit_sched       = cscan_exit_sched,
+        .init_hctx        = cscan_init_hctx,
+        .exit_hctx        = cscan_exit_hctx,
     },
     .elevator_name = "cscan",
     .elevator_owner = THIS_MODULE,
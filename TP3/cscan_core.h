@@ -0,0 +1,80 @@
+/*
+ * Núcleo do escalonador C-SCAN (cscan.c) sem dependências do block layer: o
+ * índice das requisições pendentes por setor, uma rbtree, e a escolha da
+ * próxima requisição a partir da posição da cabeça. Inserção e escolha custam
+ * O(log n). Os elementos são rb_node genéricos e o setor vem de uma função do
+ * chamador (no driver, blk_rq_pos da requisição), então o mesmo código compila
+ * em espaço de usuário contra ../userspace/include.
+ */
+#ifndef CSCAN_CORE_H
+#define CSCAN_CORE_H
+
+#include <linux/types.h>
+#include <linux/rbtree.h>
+
+typedef sector_t (*cscan_pos_fn)(const struct rb_node *node);
+
+/* Insere node no índice. Setores iguais ficam na ordem de chegada: o novo desce à direita */
+static inline void cscan_index_add(struct rb_root *root, struct rb_node *node, cscan_pos_fn pos) {
+    struct rb_node **link = &root->rb_node, *parent = NULL;
+    sector_t sector = pos(node);
+
+    while (*link) {
+        parent = *link;
+        if (sector < pos(parent)) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+        }
+    }
+    rb_link_node(node, parent, link);
+    rb_insert_color(node, root);
+}
+
+/* Primeiro pendente com setor >= head (o mais antigo entre setores iguais), ou NULL se nada está à frente */
+static inline struct rb_node *cscan_index_ceil(struct rb_root *root, sector_t head, cscan_pos_fn pos) {
+    struct rb_node *node = root->rb_node, *ceil = NULL;
+
+    while (node) {
+        if (pos(node) >= head) {
+            ceil = node;
+            node = node->rb_left;
+        } else {
+            node = node->rb_right;
+        }
+    }
+    return ceil;
+}
+
+/* Primeiro pendente (o mais antigo) exatamente no setor sector, ou NULL */
+static inline struct rb_node *cscan_index_find(struct rb_root *root, sector_t sector, cscan_pos_fn pos) {
+    struct rb_node *node = cscan_index_ceil(root, sector, pos);
+
+    return node && pos(node) == sector ? node : NULL;
+}
+
+/*
+ * Próximo pendente da varredura C-SCAN com a cabeça em head, sem retirá-lo: o
+ * primeiro setor >= head; sem nada à frente a cabeça volta ao início e o próximo é
+ * o menor setor pendente (*wrapped = true). Requisições que chegam durante a
+ * varredura à frente da cabeça entram nela. NULL com o índice vazio.
+ */
+static inline struct rb_node *cscan_index_next(struct rb_root *root, sector_t head, cscan_pos_fn pos,
+                                               bool *wrapped) {
+    struct rb_node *node = cscan_index_ceil(root, head, pos);
+
+    *wrapped = false;
+    if (!node) {
+        node = rb_first(root);
+        *wrapped = node != NULL;
+    }
+    return node;
+}
+
+/* Retira node do índice, em qualquer posição */
+static inline void cscan_index_del(struct rb_root *root, struct rb_node *node) {
+    rb_erase(node, root);
+    RB_CLEAR_NODE(node);
+}
+
+#endif
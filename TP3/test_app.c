@@ -28,8 +28,8 @@ int main() {
 
     // Configura filas de escalonamento
     printf("Configurando filas de escalonamento...\n");
-    system("echo 2 > /sys/block/sdb/queue/nomerges");
-    system("echo 4 > /sys/block/sdb/queue/max_sectors_kb");
+    system("echo 0 > /sys/block/sdb/queue/nomerges");  // Merges habilitados: o C-SCAN junta acessos adjacentes
+    system("echo 512 > /sys/block/sdb/queue/max_sectors_kb");  // Com 4 KiB nenhuma requisição mesclada caberia no limite
     system("echo 0 > /sys/block/sdb/queue/read_ahead_kb");
 
     // Abre o dispositivo de bloco (disco)
@@ -0,0 +1,235 @@
+/*
+ * Simulação e microbenchmark do núcleo do C-SCAN (TP3/cscan_core.h) em espaço de
+ * usuário. Gera acessos aleatórios como o TP3/test_app.c e, para cada
+ * profundidade de fila (cscan_queue_size), mantém a fila cheia: a cada despacho a
+ * partir da posição da cabeça chega uma requisição nova, que entra na varredura
+ * em andamento se estiver à frente da cabeça. Confere que a cabeça só anda para
+ * a frente e só volta ao início quando nada está à frente dela, que setores iguais
+ * saem na ordem de chegada, que nenhuma requisição se perde e que a árvore
+ * continua balanceada; compara o deslocamento da cabeça com a ordem de chegada.
+ * Entre os despachos há merges como os do driver: um front merge acha a
+ * requisição pelo setor, recua o setor dela e a reposiciona no índice, e a
+ * requisição absorvida sai do meio da árvore.
+ *
+ * Uso: cscan_sim [requisições] [profundidade da fila]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cscan_core.h"
+
+#define DISK_SECTORS 2097152     // Disco do TP3 (1 GiB em setores de 512 bytes)
+
+struct sim_rq {
+    struct rb_node rb_node;
+    sector_t sector;
+    long arrival;                // Ordem de entrada no índice
+    bool queued;                 // Pendente no índice
+};
+
+static const int depths[] = {10, 100, 1000, 10000};  // cscan_queue_size padrão e acima
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int rng_state = 1;
+
+static unsigned int rng(void) {
+    rng_state ^= rng_state << 13;   // xorshift32: sequência igual em qualquer libc
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static sector_t sim_rq_pos(const struct rb_node *node) {
+    return rb_entry(node, struct sim_rq, rb_node)->sector;
+}
+
+static sector_t distance(sector_t a, sector_t b) {
+    return a > b ? a - b : b - a;
+}
+
+// Altura preta da subárvore, ou -1 se alguma regra da rubro-negra foi violada
+static int rb_black_height(const struct rb_node *node) {
+    int left, right;
+
+    if (!node) {
+        return 1;
+    }
+    if ((node->rb_left && node->rb_left->rb_parent != node) ||
+        (node->rb_right && node->rb_right->rb_parent != node)) {
+        return -1;
+    }
+    if (rb_is_red(node) && ((node->rb_left && rb_is_red(node->rb_left)) ||
+                            (node->rb_right && rb_is_red(node->rb_right)))) {
+        return -1;
+    }
+    left = rb_black_height(node->rb_left);
+    right = rb_black_height(node->rb_right);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + rb_is_black(node);
+}
+
+// Nó de maior setor, para conferir que nada ficou à frente da cabeça
+static struct rb_node *rb_last_node(const struct rb_root *root) {
+    struct rb_node *node = root->rb_node;
+
+    while (node && node->rb_right) {
+        node = node->rb_right;
+    }
+    return node;
+}
+
+// Chegada de uma requisição na posição arrival da ordem de entrada: setor aleatório, às vezes repetindo o anterior
+static void arrive(struct sim_rq *rq, long arrival, sector_t last) {
+    rq->sector = rng() % DISK_SECTORS;
+    if (arrival && rng() % 8 == 0) {
+        rq->sector = last;       // Setores repetidos para conferir a estabilidade
+    }
+    rq->arrival = arrival;
+}
+
+// Uma profundidade: total requisições com a fila mantida em depth pendentes
+static int run(long total, int depth) {
+    unsigned long long start, fifo_seek = 0, cscan_seek = 0;
+    struct sim_rq *rqs = calloc(total, sizeof(*rqs));
+    struct rb_root root = RB_ROOT;
+    struct sim_rq *prev = NULL;
+    sector_t head = 0, fifo_head = 0, last = 0;
+    long arrived = 0, done = 0, sweeps = 0, merges = 0, seq = 0;
+
+    if (!rqs) {
+        perror("calloc");
+        return -1;
+    }
+
+    start = now_ns();
+    while (done < total) {
+        struct rb_node *node;
+        struct sim_rq *rq;
+        bool wrapped;
+
+        // Chegadas até a fila ter depth pendentes: cscan_add_request
+        while (arrived < total && arrived - done < depth) {
+            arrive(&rqs[arrived], seq++, last);
+            last = rqs[arrived].sector;
+            fifo_seek += distance(fifo_head, last);
+            fifo_head = last;
+            cscan_index_add(&root, &rqs[arrived].rb_node, sim_rq_pos);
+            rqs[arrived].queued = true;
+            arrived++;
+        }
+
+        // Um despacho: cscan_dispatch
+        node = cscan_index_next(&root, head, sim_rq_pos, &wrapped);
+        if (!node) {
+            fprintf(stderr, "cscan_sim: índice vazio com %ld requisições pendentes\n", arrived - done);
+            return -1;
+        }
+        rq = rb_entry(node, struct sim_rq, rb_node);
+        if (wrapped) {
+            struct rb_node *max = rb_last_node(&root);
+
+            if (max && sim_rq_pos(max) >= head) {
+                fprintf(stderr, "cscan_sim: voltou ao início com o setor %llu à frente da cabeça %llu\n",
+                        (unsigned long long)sim_rq_pos(max), (unsigned long long)head);
+                return -1;
+            }
+            cscan_seek += DISK_SECTORS - head + rq->sector;  // Vai até o fim do disco; o retorno ao início não conta
+            sweeps++;
+        } else {
+            if (rq->sector < head) {
+                fprintf(stderr, "cscan_sim: cabeça voltou de %llu para %llu sem fim de varredura\n",
+                        (unsigned long long)head, (unsigned long long)rq->sector);
+                return -1;
+            }
+            if (prev && rq->sector == prev->sector && rq->arrival < prev->arrival) {
+                fprintf(stderr, "cscan_sim: setor %llu fora da ordem de chegada\n", (unsigned long long)rq->sector);
+                return -1;
+            }
+            cscan_seek += rq->sector - head;
+        }
+        cscan_index_del(&root, node);
+        rq->queued = false;
+        head = rq->sector;
+        prev = rq;
+        done++;
+
+        // Merges: cscan_request_merged (front merge) e cscan_requests_merged
+        if (arrived - done > 1 && rng() % 8 == 0) {
+            long window = arrived < 2L * depth ? arrived : 2L * depth;
+            struct sim_rq *target = &rqs[arrived - 1 - rng() % window];
+            struct sim_rq *next = &rqs[arrived - 1 - rng() % window];
+
+            if (target->queued && target->sector >= 8) {
+                node = cscan_index_find(&root, target->sector, sim_rq_pos);  // Bio de 8 setores terminando nela
+                if (!node || sim_rq_pos(node) != target->sector) {
+                    fprintf(stderr, "cscan_sim: front merge não achou o setor %llu\n",
+                            (unsigned long long)target->sector);
+                    return -1;
+                }
+                target = rb_entry(node, struct sim_rq, rb_node);
+                cscan_index_del(&root, node);
+                target->sector -= 8;
+                target->arrival = seq++;
+                cscan_index_add(&root, node, sim_rq_pos);
+                merges++;
+            }
+            if (next->queued && next != target) {  // Requisição adjacente absorvida
+                cscan_index_del(&root, &next->rb_node);
+                next->queued = false;
+                done++;
+                merges++;
+            }
+        }
+
+        if (done % depth == 0 &&
+            (rb_black_height(root.rb_node) < 0 || (root.rb_node && rb_is_red(root.rb_node)))) {
+            fprintf(stderr, "cscan_sim: árvore desbalanceada após %ld despachos\n", done);
+            return -1;
+        }
+    }
+    start = now_ns() - start;
+
+    if (!RB_EMPTY_ROOT(&root)) {
+        fprintf(stderr, "cscan_sim: requisições esquecidas no índice\n");
+        return -1;
+    }
+    cscan_seek += DISK_SECTORS - head;  // Termina a última varredura
+
+    printf("%10ld %8d %14.1f %10ld %8ld %16llu %16llu\n", total, depth, (double)start / total, sweeps + 1,
+           merges, fifo_seek, cscan_seek);
+    free(rqs);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    long total = argc > 1 ? atol(argv[1]) : 1000000;
+    int depth = argc > 2 ? atoi(argv[2]) : 0;  // 0 = todas as profundidades de depths[]
+    int d;
+
+    if (total < 1 || depth < 0) {
+        fprintf(stderr, "Uso: %s [requisições] [profundidade da fila]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%10s %8s %14s %10s %8s %16s %16s\n", "requisições", "fila", "ns/requisição", "varreduras", "merges",
+           "setores FIFO", "setores C-SCAN");
+    if (depth) {
+        return run(total, depth) < 0;
+    }
+    for (d = 0; d < (int)(sizeof(depths) / sizeof(depths[0])); d++) {
+        rng_state = 1;
+        if (run(total, depths[d]) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
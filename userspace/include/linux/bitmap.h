@@ -0,0 +1,9 @@
+/*
+ * Shim de <linux/bitmap.h>: as funções de bitmap ficam no shim de bitops.h.
+ */
+#ifndef SHIM_LINUX_BITMAP_H
+#define SHIM_LINUX_BITMAP_H
+
+#include <linux/bitops.h>
+
+#endif
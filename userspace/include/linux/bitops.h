@@ -0,0 +1,70 @@
+/*
+ * Shim de <linux/bitops.h> e das funções de bitmap usadas pelos núcleos. As
+ * buscas usam os builtins do compilador, como as versões genéricas do kernel.
+ */
+#ifndef SHIM_LINUX_BITOPS_H
+#define SHIM_LINUX_BITOPS_H
+
+#include <limits.h>
+#include <string.h>
+#include <linux/types.h>
+
+#define BITS_PER_LONG       (sizeof(long) * CHAR_BIT)
+#define BITS_TO_LONGS(n)    (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline void __set_bit(unsigned int nr, unsigned long *addr) {
+    addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(unsigned int nr, unsigned long *addr) {
+    addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline bool test_bit(unsigned int nr, const unsigned long *addr) {
+    return (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1;
+}
+
+static inline void bitmap_zero(unsigned long *dst, unsigned int nbits) {
+    memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+// Primeiro bit ligado a partir de offset, ou size se não houver
+static inline unsigned long find_next_bit(const unsigned long *addr, unsigned long size, unsigned long offset) {
+    while (offset < size) {
+        unsigned long word = addr[offset / BITS_PER_LONG] & (~0UL << (offset % BITS_PER_LONG));
+
+        if (word) {
+            offset = offset / BITS_PER_LONG * BITS_PER_LONG + __builtin_ctzl(word);
+            return offset < size ? offset : size;
+        }
+        offset = (offset / BITS_PER_LONG + 1) * BITS_PER_LONG;
+    }
+    return size;
+}
+
+static inline unsigned long find_first_bit(const unsigned long *addr, unsigned long size) {
+    return find_next_bit(addr, size, 0);
+}
+
+// Último bit ligado, ou size se não houver
+static inline unsigned long find_last_bit(const unsigned long *addr, unsigned long size) {
+    unsigned long idx = BITS_TO_LONGS(size);
+
+    while (idx--) {
+        unsigned long word = addr[idx];
+
+        if (idx == size / BITS_PER_LONG) {
+            word &= (1UL << (size % BITS_PER_LONG)) - 1;  // Bits além de size não contam
+        }
+        if (word) {
+            return idx * BITS_PER_LONG + BITS_PER_LONG - 1 - __builtin_clzl(word);
+        }
+    }
+    return size;
+}
+
+#define for_each_set_bit(bit, addr, size) \
+    for ((bit) = find_first_bit((addr), (size)); (bit) < (size); (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+#endif
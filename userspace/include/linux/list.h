@@ -0,0 +1,90 @@
+/*
+ * Shim de <linux/list.h>: a lista circular duplamente ligada do kernel, só com
+ * as operações usadas pelos núcleos.
+ */
+#ifndef SHIM_LINUX_LIST_H
+#define SHIM_LINUX_LIST_H
+
+#include <linux/types.h>
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list) {
+    list->next = list;
+    list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev, struct list_head *next) {
+    next->prev = new;
+    new->next = next;
+    new->prev = prev;
+    prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head) {
+    __list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head) {
+    __list_add(new, head->prev, head);
+}
+
+static inline void __list_del(struct list_head *prev, struct list_head *next) {
+    next->prev = prev;
+    prev->next = next;
+}
+
+// Como no kernel, os ponteiros de um nó removido são envenenados
+static inline void list_del(struct list_head *entry) {
+    __list_del(entry->prev, entry->next);
+    entry->next = (struct list_head *)0x100;
+    entry->prev = (struct list_head *)0x122;
+}
+
+static inline void list_del_init(struct list_head *entry) {
+    __list_del(entry->prev, entry->next);
+    INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move_tail(struct list_head *list, struct list_head *head) {
+    __list_del(list->prev, list->next);
+    list_add_tail(list, head);
+}
+
+static inline int list_empty(const struct list_head *head) {
+    return head->next == head;
+}
+
+static inline void list_splice_tail_init(struct list_head *list, struct list_head *head) {
+    if (!list_empty(list)) {
+        struct list_head *first = list->next, *last = list->prev, *at = head->prev;
+
+        first->prev = at;
+        at->next = first;
+        last->next = head;
+        head->prev = last;
+        INIT_LIST_HEAD(list);
+    }
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+#define list_next_entry(pos, member) list_entry((pos)->member.next, __typeof__(*(pos)), member)
+
+#define list_for_each(pos, head) \
+    for (pos = (head)->next; pos != (head); pos = pos->next)
+#define list_for_each_safe(pos, n, head) \
+    for (pos = (head)->next, n = pos->next; pos != (head); pos = n, n = pos->next)
+#define list_for_each_entry(pos, head, member) \
+    for (pos = list_first_entry(head, __typeof__(*pos), member); &pos->member != (head); \
+         pos = list_next_entry(pos, member))
+#define list_for_each_entry_safe(pos, n, head, member) \
+    for (pos = list_first_entry(head, __typeof__(*pos), member), n = list_next_entry(pos, member); \
+         &pos->member != (head); pos = n, n = list_next_entry(n, member))
+
+#endif
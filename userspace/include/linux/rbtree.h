@@ -0,0 +1,287 @@
+/*
+ * Shim de <linux/rbtree.h>: árvore rubro-negra com a mesma interface do kernel
+ * (o chamador desce a árvore, chama rb_link_node e depois rb_insert_color). O
+ * balanceamento segue o lib/rbtree.c clássico do kernel, com ponteiro e cor
+ * separados em vez de compactados num long.
+ */
+#ifndef SHIM_LINUX_RBTREE_H
+#define SHIM_LINUX_RBTREE_H
+
+#include <linux/types.h>
+
+#define RB_RED   0
+#define RB_BLACK 1
+
+struct rb_node {
+    struct rb_node *rb_parent;
+    struct rb_node *rb_right;
+    struct rb_node *rb_left;
+    int rb_color;
+};
+
+struct rb_root {
+    struct rb_node *rb_node;
+};
+
+#define RB_ROOT                 (struct rb_root) { NULL }
+#define RB_EMPTY_ROOT(root)     ((root)->rb_node == NULL)
+#define RB_EMPTY_NODE(node)     ((node)->rb_parent == (node))
+#define RB_CLEAR_NODE(node)     ((node)->rb_parent = (node))
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+#define rb_parent(node)         ((node)->rb_parent)
+#define rb_is_red(node)         ((node)->rb_color == RB_RED)
+#define rb_is_black(node)       ((node)->rb_color == RB_BLACK)
+
+static inline void rb_link_node(struct rb_node *node, struct rb_node *parent, struct rb_node **rb_link) {
+    node->rb_parent = parent;
+    node->rb_color = RB_RED;
+    node->rb_left = node->rb_right = NULL;
+    *rb_link = node;
+}
+
+// Troca old por new no pai de old (ou na raiz)
+static inline void __rb_change_child(struct rb_node *old, struct rb_node *new, struct rb_node *parent,
+                                     struct rb_root *root) {
+    if (!parent) {
+        root->rb_node = new;
+    } else if (parent->rb_left == old) {
+        parent->rb_left = new;
+    } else {
+        parent->rb_right = new;
+    }
+}
+
+static inline void __rb_rotate_left(struct rb_node *node, struct rb_root *root) {
+    struct rb_node *right = node->rb_right;
+
+    node->rb_right = right->rb_left;
+    if (right->rb_left) {
+        right->rb_left->rb_parent = node;
+    }
+    right->rb_left = node;
+    right->rb_parent = node->rb_parent;
+    __rb_change_child(node, right, node->rb_parent, root);
+    node->rb_parent = right;
+}
+
+static inline void __rb_rotate_right(struct rb_node *node, struct rb_root *root) {
+    struct rb_node *left = node->rb_left;
+
+    node->rb_left = left->rb_right;
+    if (left->rb_right) {
+        left->rb_right->rb_parent = node;
+    }
+    left->rb_right = node;
+    left->rb_parent = node->rb_parent;
+    __rb_change_child(node, left, node->rb_parent, root);
+    node->rb_parent = left;
+}
+
+static inline void rb_insert_color(struct rb_node *node, struct rb_root *root) {
+    struct rb_node *parent, *gparent;
+
+    while ((parent = rb_parent(node)) && rb_is_red(parent)) {
+        gparent = rb_parent(parent);     // Existe: a raiz é sempre preta
+
+        if (parent == gparent->rb_left) {
+            struct rb_node *uncle = gparent->rb_right;
+
+            if (uncle && rb_is_red(uncle)) {
+                uncle->rb_color = RB_BLACK;
+                parent->rb_color = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (parent->rb_right == node) {
+                __rb_rotate_left(parent, root);
+                node = parent;
+                parent = rb_parent(node);
+            }
+            parent->rb_color = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            __rb_rotate_right(gparent, root);
+        } else {
+            struct rb_node *uncle = gparent->rb_left;
+
+            if (uncle && rb_is_red(uncle)) {
+                uncle->rb_color = RB_BLACK;
+                parent->rb_color = RB_BLACK;
+                gparent->rb_color = RB_RED;
+                node = gparent;
+                continue;
+            }
+            if (parent->rb_left == node) {
+                __rb_rotate_right(parent, root);
+                node = parent;
+                parent = rb_parent(node);
+            }
+            parent->rb_color = RB_BLACK;
+            gparent->rb_color = RB_RED;
+            __rb_rotate_left(gparent, root);
+        }
+    }
+    root->rb_node->rb_color = RB_BLACK;
+}
+
+// Rebalanceia depois de remover um nó preto; node (talvez NULL) ficou com um preto a menos
+static inline void __rb_erase_color(struct rb_node *node, struct rb_node *parent, struct rb_root *root) {
+    struct rb_node *other;
+
+    while ((!node || rb_is_black(node)) && node != root->rb_node) {
+        if (parent->rb_left == node) {
+            other = parent->rb_right;
+            if (rb_is_red(other)) {
+                other->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                __rb_rotate_left(parent, root);
+                other = parent->rb_right;
+            }
+            if ((!other->rb_left || rb_is_black(other->rb_left)) &&
+                (!other->rb_right || rb_is_black(other->rb_right))) {
+                other->rb_color = RB_RED;
+                node = parent;
+                parent = rb_parent(node);
+            } else {
+                if (!other->rb_right || rb_is_black(other->rb_right)) {
+                    other->rb_left->rb_color = RB_BLACK;
+                    other->rb_color = RB_RED;
+                    __rb_rotate_right(other, root);
+                    other = parent->rb_right;
+                }
+                other->rb_color = parent->rb_color;
+                parent->rb_color = RB_BLACK;
+                other->rb_right->rb_color = RB_BLACK;
+                __rb_rotate_left(parent, root);
+                node = root->rb_node;
+                break;
+            }
+        } else {
+            other = parent->rb_left;
+            if (rb_is_red(other)) {
+                other->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                __rb_rotate_right(parent, root);
+                other = parent->rb_left;
+            }
+            if ((!other->rb_left || rb_is_black(other->rb_left)) &&
+                (!other->rb_right || rb_is_black(other->rb_right))) {
+                other->rb_color = RB_RED;
+                node = parent;
+                parent = rb_parent(node);
+            } else {
+                if (!other->rb_left || rb_is_black(other->rb_left)) {
+                    other->rb_right->rb_color = RB_BLACK;
+                    other->rb_color = RB_RED;
+                    __rb_rotate_left(other, root);
+                    other = parent->rb_left;
+                }
+                other->rb_color = parent->rb_color;
+                parent->rb_color = RB_BLACK;
+                other->rb_left->rb_color = RB_BLACK;
+                __rb_rotate_right(parent, root);
+                node = root->rb_node;
+                break;
+            }
+        }
+    }
+    if (node) {
+        node->rb_color = RB_BLACK;
+    }
+}
+
+static inline void rb_erase(struct rb_node *node, struct rb_root *root) {
+    struct rb_node *child, *parent;
+    int color;
+
+    if (!node->rb_left) {
+        child = node->rb_right;
+    } else if (!node->rb_right) {
+        child = node->rb_left;
+    } else {                             // Dois filhos: o sucessor ocupa o lugar de node
+        struct rb_node *old = node, *left;
+
+        node = node->rb_right;
+        while ((left = node->rb_left) != NULL) {
+            node = left;
+        }
+        __rb_change_child(old, node, rb_parent(old), root);
+
+        child = node->rb_right;
+        parent = rb_parent(node);
+        color = node->rb_color;
+        if (parent == old) {
+            parent = node;
+        } else {
+            if (child) {
+                child->rb_parent = parent;
+            }
+            parent->rb_left = child;
+            node->rb_right = old->rb_right;
+            old->rb_right->rb_parent = node;
+        }
+        node->rb_parent = old->rb_parent;
+        node->rb_color = old->rb_color;
+        node->rb_left = old->rb_left;
+        old->rb_left->rb_parent = node;
+        goto color;
+    }
+
+    parent = rb_parent(node);
+    color = node->rb_color;
+    if (child) {
+        child->rb_parent = parent;
+    }
+    __rb_change_child(node, child, parent, root);
+
+color:
+    if (color == RB_BLACK) {
+        __rb_erase_color(child, parent, root);
+    }
+}
+
+static inline struct rb_node *rb_first(const struct rb_root *root) {
+    struct rb_node *n = root->rb_node;
+
+    if (!n) {
+        return NULL;
+    }
+    while (n->rb_left) {
+        n = n->rb_left;
+    }
+    return n;
+}
+
+static inline struct rb_node *rb_next(const struct rb_node *node) {
+    struct rb_node *parent;
+
+    if (node->rb_right) {
+        node = node->rb_right;
+        while (node->rb_left) {
+            node = node->rb_left;
+        }
+        return (struct rb_node *)node;
+    }
+    while ((parent = rb_parent(node)) && node == parent->rb_right) {
+        node = parent;
+    }
+    return parent;
+}
+
+static inline struct rb_node *rb_prev(const struct rb_node *node) {
+    struct rb_node *parent;
+
+    if (node->rb_left) {
+        node = node->rb_left;
+        while (node->rb_right) {
+            node = node->rb_right;
+        }
+        return (struct rb_node *)node;
+    }
+    while ((parent = rb_parent(node)) && node == parent->rb_left) {
+        node = parent;
+    }
+    return parent;
+}
+
+#endif
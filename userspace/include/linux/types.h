@@ -0,0 +1,24 @@
+/*
+ * Shim de <linux/types.h> para compilar os núcleos dos módulos em espaço de
+ * usuário: os tipos __u32 etc. vêm do cabeçalho do sistema, os tipos internos
+ * do kernel são definidos aqui.
+ */
+#ifndef SHIM_LINUX_TYPES_H
+#define SHIM_LINUX_TYPES_H
+
+#include_next <linux/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t  s32;
+typedef int64_t  s64;
+typedef u64      sector_t;
+
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#endif
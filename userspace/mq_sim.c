@@ -0,0 +1,241 @@
+/*
+ * Simulação e microbenchmark da fila de prioridades do mqueue (TP2/mqueue_core.h)
+ * em espaço de usuário. Cada rodada enche uma fila de max_messages mensagens
+ * com prioridades aleatórias, aplicando o descarte da MQUEUE_OVERFLOW_DROP_OLDEST
+ * como o driver, e intercala retiradas.
+ *
+ * A primeira passada confere a cada operação o que o driver promete: a retirada
+ * devolve a mensagem mais antiga da prioridade mais alta, nada mais urgente que a
+ * nova é descartado, e contador, bytes e bitmap batem com as listas. A segunda
+ * passada, sem conferências, mede ns por operação.
+ *
+ * Uso: mq_sim [operações] [max_messages]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mqueue_core.h"
+
+struct sim_msg {
+    struct list_head link;
+    unsigned int level;
+    unsigned int size;
+    unsigned long seq;           // Ordem de chegada
+};
+
+struct sim_stats {
+    long pushed, popped, evicted, rejected;
+};
+
+static const int prio_counts[] = {1, 4, MQUEUE_PRIO_MAX};  // Prioridades distintas em uso
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int rng_state = 1;
+
+static unsigned int rng(void) {
+    rng_state ^= rng_state << 13;   // xorshift32: sequência igual em qualquer libc
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void fail(const char *what, long op) {
+    fprintf(stderr, "mq_sim: %s (operação %ld)\n", what, op);
+    exit(1);
+}
+
+// Confere contador, bytes, bitmap e ordem FIFO de cada subfila
+static void check_queue(struct mq_prio_queue *pq, long op) {
+    unsigned long bytes = 0;
+    int level, count = 0;
+
+    for (level = 0; level < MQUEUE_PRIO_MAX; level++) {
+        struct sim_msg *msg;
+        unsigned long last = 0;
+        int n = 0;
+
+        list_for_each_entry(msg, &pq->lists[level], link) {
+            if (msg->level != (unsigned int)level || (n && msg->seq <= last)) {
+                fail("subfila fora de ordem", op);
+            }
+            last = msg->seq;
+            bytes += msg->size;
+            n++;
+        }
+        if (test_bit(level, pq->map) != (n > 0)) {
+            fail("bitmap não confere com as subfilas", op);
+        }
+        count += n;
+    }
+    if (count != pq->count || bytes != pq->bytes) {
+        fail("contador ou bytes não conferem", op);
+    }
+}
+
+// Enfileira com o descarte da DROP_OLDEST do driver; pool guarda as mensagens livres
+static void push(struct mq_prio_queue *pq, struct list_head *pool, int max_messages, int nprio,
+                 unsigned long seq, struct sim_stats *st, int check, long op) {
+    struct sim_msg *msg = list_first_entry(pool, struct sim_msg, link);
+
+    msg->level = mq_prio_level(rng() % nprio);
+    msg->size = 1 + rng() % 250;
+    msg->seq = seq;
+
+    while (pq->count >= max_messages) {
+        unsigned int victim = mq_pq_victim_level(pq, msg->level);
+        struct sim_msg *oldest;
+
+        if (victim == MQ_LEVEL_NONE) {   // A nova é a menos urgente da fila
+            if (check && find_last_bit(pq->map, MQUEUE_PRIO_MAX) >= msg->level) {
+                fail("mensagem nova recusada com vítima disponível", op);
+            }
+            st->rejected++;
+            return;
+        }
+        if (check && victim < msg->level) {
+            fail("descartou mensagem mais urgente que a nova", op);
+        }
+        oldest = list_first_entry(&pq->lists[victim], struct sim_msg, link);
+        mq_pq_remove(pq, &oldest->link, oldest->level, oldest->size);
+        list_add(&oldest->link, pool);
+        st->evicted++;
+    }
+
+    list_del(&msg->link);
+    mq_pq_push(pq, &msg->link, msg->level, msg->size);
+    st->pushed++;
+}
+
+static void pop(struct mq_prio_queue *pq, struct list_head *pool, struct sim_stats *st, int check, long op) {
+    unsigned int level;
+    struct list_head *link = mq_pq_peek(pq, &level);
+    struct sim_msg *msg;
+
+    if (!link) {
+        if (check && pq->count) {
+            fail("fila com mensagens devolveu vazio", op);
+        }
+        return;
+    }
+    msg = list_entry(link, struct sim_msg, link);
+    if (check) {
+        unsigned int l;
+
+        for (l = 0; l < level; l++) {
+            if (!list_empty(&pq->lists[l])) {
+                fail("retirada ignorou prioridade mais alta", op);
+            }
+        }
+        if (msg->level != level || link != pq->lists[level].next) {
+            fail("retirada não devolveu a mais antiga do nível", op);
+        }
+    }
+    mq_pq_remove(pq, link, msg->level, msg->size);
+    list_add(&msg->link, pool);
+    st->popped++;
+}
+
+// Uma passada de ops operações; 60% de envios para a fila viver cheia
+static void run(long ops, int max_messages, int nprio, int check, struct sim_stats *st) {
+    struct sim_msg *msgs = calloc(max_messages + 1, sizeof(*msgs));
+    struct mq_prio_queue pq;
+    LIST_HEAD(pool);
+    LIST_HEAD(drained);
+    long op;
+    int i;
+
+    if (!msgs) {
+        fail("sem memória", 0);
+    }
+    mq_pq_init(&pq);
+    for (i = 0; i <= max_messages; i++) {
+        list_add_tail(&msgs[i].link, &pool);
+    }
+
+    for (op = 0; op < ops; op++) {
+        if (rng() % 10 < 6) {
+            push(&pq, &pool, max_messages, nprio, op + 1, st, check, op);
+        } else {
+            pop(&pq, &pool, st, check, op);
+        }
+        if (check) {
+            check_queue(&pq, op);
+        }
+    }
+
+    // O esvaziamento da remoção do processo devolve tudo, da mais urgente à menos
+    mq_pq_take_all(&pq, &drained);
+    if (check) {
+        struct sim_msg *msg;
+        unsigned int last = 0;
+
+        list_for_each_entry(msg, &drained, link) {
+            if (msg->level < last) {
+                fail("esvaziamento fora da ordem de prioridade", ops);
+            }
+            last = msg->level;
+        }
+        check_queue(&pq, ops);
+    }
+    free(msgs);
+}
+
+// Posições do anel perto da volta de 2^32 e tails arbitrários do consumidor
+static void check_ring(long ops) {
+    long i;
+
+    for (i = 0; i < ops; i++) {
+        unsigned int slots = 1u << (rng() % 11);  // Potência de 2, como ring_slots no registro
+        unsigned int head = 0xffffff00u + rng() % 512;
+        size_t ring = (size_t)slots * 64;
+        unsigned int tail = rng() % 4 ? head - rng() % (slots + 1) : rng();
+        unsigned int clamped = mq_ring_clamp_tail(head, tail, slots);
+
+        if (head - clamped > slots || (head - tail <= slots && clamped != tail)) {
+            fail("tail do anel limitado errado", i);
+        }
+        if (mq_ring_slot_offset(head, slots, 64) >= ring) {
+            fail("slot fora do anel", i);
+        }
+        // head - 1 e head em slots vizinhos, inclusive de 0xffffffff para 0
+        if (mq_ring_slot_offset(head, slots, 64) != (mq_ring_slot_offset(head - 1, slots, 64) + 64) % ring) {
+            fail("posições consecutivas do anel fora de slots vizinhos", i);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long ops = argc > 1 ? atol(argv[1]) : 1000000;  // Operações medidas em cada ponto
+    int max_messages = argc > 2 ? atoi(argv[2]) : 64;
+    int p;
+
+    if (ops < 1 || max_messages < 1) {
+        fprintf(stderr, "Uso: %s [operações] [max_messages]\n", argv[0]);
+        return 1;
+    }
+
+    check_ring(ops / 10 + 1);
+    printf("%11s %10s %10s %14s %10s %10s\n", "prioridades", "ns/op", "enviadas", "retiradas", "descartes", "recusadas");
+    for (p = 0; p < (int)(sizeof(prio_counts) / sizeof(prio_counts[0])); p++) {
+        struct sim_stats checked = {0}, timed = {0};
+        unsigned long long start, elapsed;
+
+        rng_state = 1;
+        run(ops / 10 + 1, max_messages, prio_counts[p], 1, &checked);  // Conferência completa, O(n) por operação
+
+        rng_state = 1;
+        start = now_ns();
+        run(ops, max_messages, prio_counts[p], 0, &timed);
+        elapsed = now_ns() - start;
+        printf("%11d %10.1f %10ld %14ld %10ld %10ld\n", prio_counts[p], (double)elapsed / ops,
+               timed.pushed, timed.popped, timed.evicted, timed.rejected);
+    }
+    return 0;
+}